@@ -0,0 +1,87 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace nx_meta_plugin {
+
+/**
+ * Whether the heap allocations are counted: the plugin is built with -DcountAllocations=ON, which
+ * replaces the global operator new of the plugin with a counting one. Allocations made inside
+ * the shared libraries the plugin links to, and malloc() calls, are not seen.
+ */
+#if defined(NX_PLUGIN_COUNT_ALLOCATIONS)
+    constexpr bool kCountAllocations = true;
+#else
+    constexpr bool kCountAllocations = false;
+#endif
+
+    /** Parts of the pipeline the allocations are counted for. */
+    enum class AllocationStage {
+        other, /**< Anything outside of an AllocationScope. */
+        detection,
+        tracking,
+        classification,
+        metadata,
+    };
+
+    constexpr size_t kAllocationStageCount = 5;
+
+    /** Allocations made in each stage, indexed by AllocationStage. */
+    using AllocationCounts = std::array<uint64_t, kAllocationStageCount>;
+
+    const char *allocationStageName(AllocationStage stage);
+
+    /** @return Allocations made in each stage so far by all threads; all 0 unless counted. */
+    AllocationCounts allocationCounts();
+
+/**
+ * Counts the allocations of the calling thread for the stage while it lives. Scopes nest: the
+ * previous stage is counted again when the scope ends.
+ */
+    class AllocationScope {
+    public:
+        explicit AllocationScope(AllocationStage stage);
+
+        ~AllocationScope();
+
+        AllocationScope(const AllocationScope &) = delete;
+        AllocationScope &operator=(const AllocationScope &) = delete;
+
+    private:
+        const AllocationStage m_previousStage;
+    };
+
+/**
+ * Measures the allocations per frame of every stage in the steady state, after the tracks and the
+ * buffers have settled, and checks them against a budget.
+ */
+    class AllocationMonitor {
+    public:
+        /** Start measuring; the frames before are not counted. */
+        void start();
+
+        /** Count one more frame. */
+        void onFrame() { ++m_frames; }
+
+        /** @return Allocations per frame in the stage since start(). */
+        double allocationsPerFrame(AllocationStage stage) const;
+
+        /**
+         * @param budget Allocations per frame allowed in each stage at most, on average. The
+         *     allocations outside of any stage are not checked.
+         * @return Whether every stage has allocated within its budget since start().
+         */
+        bool isWithin(const AllocationCounts &budget) const;
+
+        uint64_t frames() const { return m_frames; }
+
+    private:
+        AllocationCounts m_startCounts{};
+        uint64_t m_frames = 0;
+    };
+
+}
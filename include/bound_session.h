@@ -0,0 +1,60 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <onnxruntime_cxx_api.h>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "model_registry.h"
+
+namespace nx_meta_plugin {
+
+/**
+ * Runs a ModelSession through an Ort::IoBinding with long-lived input and output buffers, so that
+ * inference does not allocate tensors once the buffers have reached their size.
+ *
+ * The buffers grow to the largest shape seen and are rebound only when the input shape changes.
+ * The output shape of an input shape is learnt on the first run with that shape, when the output is
+ * still allocated by ONNX Runtime; from then on the output is written straight into the buffer.
+ *
+ * Not thread-safe; each detector or classifier owns its own instance. The session must outlive it.
+ */
+    class BoundSession {
+    public:
+        explicit BoundSession(ModelSession *session);
+
+        /**
+         * @return Input buffer of the given shape, to be filled before run(). Invalidated by the
+         *     next call with a different shape.
+         */
+        float *input(const std::vector<int64_t> &inputShape);
+
+        /** Run the model on the input buffer. Throws the exception thrown by ONNX Runtime, if any. */
+        void run();
+
+        const float *output() const { return m_output.data(); }
+
+        const std::vector<int64_t> &outputShape() const { return m_outputShape; }
+
+    private:
+        void bindOutput();
+
+    private:
+        ModelSession *const m_session;
+        Ort::IoBinding m_binding;
+        Ort::MemoryInfo m_memoryInfo;
+
+        std::vector<float> m_input;
+        std::vector<int64_t> m_inputShape;
+        std::vector<float> m_output;
+        std::vector<int64_t> m_outputShape;
+        bool m_isOutputBound = false; /**< Whether the output is written to m_output directly. */
+
+        /** Output shapes learnt so far, by input shape. */
+        std::map<std::vector<int64_t>, std::vector<int64_t>> m_outputShapes;
+    };
+
+}
@@ -0,0 +1,118 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace nx_meta_plugin {
+
+    /** @return Capacity of a BoundedQueue constructed with the given one: a power of two, at least 2. */
+    constexpr size_t boundedQueueCapacity(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        return size;
+    }
+
+/**
+ * Bounded lock-free multi-producer multi-consumer queue (the array-based algorithm of Dmitry
+ * Vyukov). Each cell carries a sequence number which tells producers and consumers whether the
+ * cell is free or filled for their lap around the ring, so a push or a pop is one compare-exchange
+ * on the position counter plus one release store, and never blocks.
+ *
+ * Multiple consumers are needed by the drop-oldest policy of DeviceAgent, where the producer pops
+ * the oldest item itself when the queue is full.
+ *
+ * @param T Must be default-constructible and move-assignable; a popped cell is left moved-from.
+ */
+    template<typename T>
+    class BoundedQueue {
+    public:
+        /** @param capacity Rounded up to a power of two. */
+        explicit BoundedQueue(size_t capacity) {
+            const size_t size = boundedQueueCapacity(capacity);
+            m_mask = size - 1;
+            m_cells = std::make_unique<Cell[]>(size);
+            for (size_t i = 0; i < size; ++i)
+                m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        BoundedQueue(const BoundedQueue &) = delete;
+
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        size_t capacity() const { return m_mask + 1; }
+
+        /** @return Number of items, exact only when no push or pop is in progress. */
+        size_t size() const {
+            const size_t dequeuePosition = m_dequeuePosition.load(std::memory_order_relaxed);
+            const size_t enqueuePosition = m_enqueuePosition.load(std::memory_order_relaxed);
+            return enqueuePosition > dequeuePosition ? enqueuePosition - dequeuePosition : 0;
+        }
+
+        /** @return False if the queue is full; value is left untouched then. */
+        bool tryPush(T &value) {
+            size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell &cell = m_cells[position & m_mask];
+                const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                const ptrdiff_t difference = (ptrdiff_t) sequence - (ptrdiff_t) position;
+                if (difference == 0) {
+                    if (m_enqueuePosition.compare_exchange_weak(
+                            position, position + 1, std::memory_order_relaxed)) {
+                        cell.value = std::move(value);
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false; //< The cell still holds the item of the previous lap.
+                } else {
+                    position = m_enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /** @return False if the queue is empty. */
+        bool tryPop(T *outValue) {
+            size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell &cell = m_cells[position & m_mask];
+                const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                const ptrdiff_t difference = (ptrdiff_t) sequence - (ptrdiff_t) (position + 1);
+                if (difference == 0) {
+                    if (m_dequeuePosition.compare_exchange_weak(
+                            position, position + 1, std::memory_order_relaxed)) {
+                        *outValue = std::move(cell.value);
+                        cell.value = T();
+                        cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false; //< The cell has not been filled in this lap yet.
+                } else {
+                    position = m_dequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence{0};
+            T value;
+        };
+
+        static constexpr size_t kCacheLineSize = 64;
+
+    private:
+        std::unique_ptr<Cell[]> m_cells;
+        size_t m_mask = 0;
+
+        // On separate cache lines, so that the producer and the consumer do not contend.
+        alignas(kCacheLineSize) std::atomic<size_t> m_enqueuePosition{0};
+        alignas(kCacheLineSize) std::atomic<size_t> m_dequeuePosition{0};
+    };
+
+}
@@ -0,0 +1,115 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "tracker_backend.h"
+
+namespace nx_meta_plugin {
+
+/**
+ * SORT/ByteTrack-style tracker backend: motion only, no appearance, so its cost does not depend on
+ * the image and grows slowly with the number of people.
+ *
+ * Every track has a constant-velocity Kalman filter on its box center and size, stepped once per
+ * processed frame. Detections are associated with the predicted boxes by IoU, greedily from the
+ * largest overlap. As in ByteTrack, the confident detections are associated first, with all the
+ * tracks, and then the low-confidence ones, only with the tracks matched in the previous frame:
+ * this keeps tracks through partial occlusions without starting tracks on false positives.
+ *
+ * The process and measurement noise is diagonal, so every coordinate of a box has a filter of its
+ * own, with a 2x2 covariance. Track state is stored as structure of arrays, one array per value,
+ * so that predicting all the tracks is a few straight loops.
+ */
+    class ByteTracker : public TrackerBackend {
+    public:
+        /** Detections at least this confident are associated first, and can start tracks. */
+        static constexpr float kHighScore = 0.5f;
+
+        /** Less confident detections are ignored. */
+        static constexpr float kLowScore = 0.1f;
+
+        /** Unmatched detections at least this confident start new tracks. */
+        static constexpr float kNewTrackScore = 0.6f;
+
+        // Minimum IoU of a detection with the predicted box of a track, to be associated with it.
+        static constexpr float kMinHighScoreIou = 0.2f;
+        static constexpr float kMinLowScoreIou = 0.5f;
+
+    public:
+        virtual cv::tbm::TrackedObjects process(
+                const cv::Mat &frame,
+                const cv::tbm::TrackedObjects &detections,
+                int64_t timestampUs) override;
+
+        virtual void setForgetDelay(size_t frameCount) override { m_forgetDelay = frameCount; }
+
+        virtual bool hasActiveTracks() const override { return !m_ids.empty(); }
+
+        virtual void trackMotions(std::vector<TrackMotion> *outTrackMotions) const override;
+
+    private:
+        /** Kalman filter of one coordinate of the box, for every track. */
+        struct KalmanAxis {
+            std::vector<float> position;
+            std::vector<float> velocity; /**< Per processed frame. */
+            std::vector<float> positionVariance;
+            std::vector<float> covariance;
+            std::vector<float> velocityVariance;
+        };
+
+        enum Axis {
+            centerX,
+            centerY,
+            width,
+            height,
+        };
+
+        struct Match {
+            float iou;
+            uint32_t track;
+            uint32_t detection;
+        };
+
+    private:
+        void predict();
+
+        void associate(const cv::tbm::TrackedObjects &detections, float minScore, float maxScore,
+                       bool onlyMatchedTracks, float minIou);
+
+        void update(size_t track, const cv::Rect &box);
+
+        void addTrack(const cv::Rect &box, int64_t timestampUs);
+
+        void removeTrack(size_t track);
+
+        float boxScale(Axis axis, size_t track) const;
+
+    private:
+        std::array<KalmanAxis, 4> m_axes;
+        std::vector<int64_t> m_ids;
+        std::vector<uint32_t> m_lostFrames; /**< Processed frames since the last match. */
+        std::vector<cv::Rect> m_lastBoxes; /**< Last matched detection. */
+        std::vector<int64_t> m_lastSeenUs;
+
+        int64_t m_nextId = 0;
+        size_t m_forgetDelay = 75;
+        int64_t m_lastTimestampUs = -1;
+        double m_frameIntervalUs = 0; /**< Average interval between the processed frames. */
+
+        // Used only by process().
+        std::vector<float> m_previousWidths; /**< Before the prediction, for its noise. */
+        std::vector<float> m_previousHeights;
+        std::vector<float> m_x1;
+        std::vector<float> m_y1;
+        std::vector<float> m_x2;
+        std::vector<float> m_y2;
+        std::vector<int32_t> m_trackDetections; /**< Detection matched with each track, or -1. */
+        std::vector<int32_t> m_detectionTracks; /**< Track matched with each detection, or -1. */
+        std::vector<Match> m_matches;
+    };
+
+}
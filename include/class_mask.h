@@ -0,0 +1,40 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+
+namespace nx_meta_plugin {
+
+/**
+ * Set of class ids of a model, usable in constant expressions.
+ */
+    class ClassMask {
+    public:
+        static constexpr int kMaxClasses = 128;
+
+        constexpr ClassMask() = default;
+
+        constexpr ClassMask(std::initializer_list<int> classIds) {
+            for (const int classId: classIds)
+                m_words[(size_t) (classId / 64)] |= uint64_t{1} << (classId % 64);
+        }
+
+        static constexpr ClassMask all() {
+            ClassMask result;
+            result.m_words = {~uint64_t{0}, ~uint64_t{0}};
+            return result;
+        }
+
+        constexpr bool contains(int classId) const {
+            return classId >= 0 && classId < kMaxClasses
+                   && (m_words[(size_t) (classId / 64)] >> (classId % 64) & 1) != 0;
+        }
+
+    private:
+        std::array<uint64_t, kMaxClasses / 64> m_words{};
+    };
+
+}
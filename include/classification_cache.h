@@ -0,0 +1,89 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <nx/sdk/uuid.h>
+
+#include "detection.h"
+
+namespace nx_meta_plugin {
+
+/**
+ * Labels of the tracks, so that a tracked object need not be classified on every frame.
+ *
+ * Every classification of a track is a vote for its label, weighted by the classifier confidence;
+ * the track gets the label with the most weight among its last kVoteHistorySize votes. A track is
+ * classified again only when it is new, while its vote is uncertain (fewer than kMinVotes votes,
+ * no weight at all, or less than kCertainVoteShare of the weight for the leading label), and every
+ * refresh interval.
+ *
+ * Not thread-safe; used only by the tracking thread of a DeviceAgent.
+ */
+    class ClassificationCache {
+    public:
+        static constexpr size_t kVoteHistorySize = 8;
+        static constexpr size_t kMinVotes = 3;
+        static constexpr float kCertainVoteShare = 0.75f;
+
+        /** Tracks not looked up for this long are forgotten. */
+        static constexpr int64_t kEntryLifetimeUs = 10'000'000;
+
+        struct Stats {
+            uint64_t lookups = 0;
+            uint64_t hits = 0;
+
+            double hitRate() const { return lookups > 0 ? (double) hits / (double) lookups : 0; }
+        };
+
+    public:
+        /** @param intervalUs 0 to classify every track on every frame. */
+        void setRefreshInterval(int64_t intervalUs);
+
+        /**
+         * @param outClassId Classifier class id of the track, if it is known.
+         * @return False if the track has to be classified on this frame.
+         */
+        bool lookup(const nx::sdk::Uuid &trackId, int64_t timestampUs, int *outClassId);
+
+        /**
+         * Add the classification of the track on this frame to its votes.
+         *
+         * @return Classifier class id of the track voted by its classifications so far.
+         */
+        int update(
+                const nx::sdk::Uuid &trackId,
+                const Classification &classification,
+                int64_t timestampUs);
+
+        /** Forget the tracks which have not been looked up for kEntryLifetimeUs. */
+        void removeStale(int64_t timestampUs);
+
+        void clear();
+
+        const Stats &stats() const { return m_stats; }
+
+    private:
+        struct Entry {
+            std::vector<Classification> votes; /**< Ring of the last kVoteHistorySize votes. */
+            size_t nextVote = 0;
+            int classId = kUnknownClassification;
+            bool certain = false;
+            int64_t classifiedUs = 0;
+            int64_t lastSeenUs = 0;
+        };
+
+    private:
+        static void vote(Entry *entry);
+
+    private:
+        int64_t m_refreshIntervalUs = 0;
+        std::map<nx::sdk::Uuid, Entry> m_entries;
+        Stats m_stats;
+    };
+
+}
@@ -2,24 +2,118 @@
 
 #pragma once
 
-#include <memory>
+#include <array>
+#include <cstddef>
+#include <memory_resource>
 #include <vector>
-#include <string>
 #include <opencv2/opencv.hpp>
-#include <nx/sdk/analytics/rect.h>
 #include <nx/sdk/uuid.h>
 
+#include "class_mask.h"
+
 namespace nx_meta_plugin {
-    extern const std::vector<std::string> kClasses;
-    extern const std::vector<std::string> kClassesToDetect;
-    extern const std::vector<std::string> kClassesToClassification;
-
-    struct Detection {
-        const nx::sdk::analytics::Rect boundingBox;
-        std::string classLabel;
-        const float confidence;
-        const nx::sdk::Uuid trackId;
+    /** Ids of the detector classes the plugin reports, in the order of the model output. */
+    constexpr int kPersonClassId = 0;
+    constexpr int kCatClassId = 15;
+    constexpr int kDogClassId = 16;
+
+    /** Labels of the detector classes (COCO), indexed by class id. */
+    constexpr std::array<const char *, 80> kClasses{
+            "person", "bicycle", "car", "motorbike", "aeroplane", "bus",
+            "train", "truck", "boat", "traffic light", "fire hydrant",
+            "stop sign", "parking meter", "bench", "bird", "cat", "dog",
+            "horse", "sheep", "cow", "elephant", "bear", "zebra", "giraffe",
+            "backpack", "umbrella", "handbag", "tie", "suitcase", "frisbee",
+            "skis", "snowboard", "sports ball", "kite", "baseball bat",
+            "baseball glove", "skateboard", "surfboard", "tennis racket",
+            "bottle", "wine glass", "cup", "fork", "knife", "spoon", "bowl",
+            "banana", "apple", "sandwich", "orange", "broccoli", "carrot",
+            "hot dog", "pizza", "donut", "cake", "chair", "sofa",
+            "pottedplant", "bed", "diningtable", "toilet", "tvmonitor",
+            "laptop", "mouse", "remote", "keyboard", "cell phone", "microwave",
+            "oven", "toaster", "sink", "refrigerator", "book", "clock", "vase",
+            "scissors", "teddy bear", "hair drier", "toothbrush"};
+
+    /**
+     * Detector classes the plugin reports. Only these class channels of the model output are
+     * scanned, so a person-only deployment reads 1 of the 80 class rows.
+     */
+    constexpr ClassMask kClassesToDetect{kPersonClassId};
+
+    /** Labels of the classifier classes, indexed by class id. */
+    constexpr std::array<const char *, 2> kClassesToClassification{"CA", "PN"};
+
+    /** Classifier class id of the objects not classified, or classified as none of the classes. */
+    constexpr int kUnknownClassification = -1;
+
+    /** @return Label of the classifier class id, "Unknown" for kUnknownClassification. */
+    inline const char *classificationLabel(int classId) {
+        if (classId < 0 || (size_t) classId >= kClassesToClassification.size())
+            return "Unknown";
+        return kClassesToClassification[(size_t) classId];
+    }
+
+    /** Result of classifying one crop. */
+    struct Classification {
+        int classId = kUnknownClassification; /**< Index into kClassesToClassification. */
+        float confidence = 0; /**< Score of the class; 0 when no class was found. */
     };
 
-    using DetectionList = std::vector<std::shared_ptr<Detection>>;
+    /**
+     * Detections of one frame, as parallel arrays indexed by detection: the detector fills the
+     * boxes, classes and confidences, the tracker the track ids, and the classifier the labels.
+     * Boxes stay in frame pixels through the whole pipeline; they are normalized only when put
+     * into the metadata. The arrays keep their capacity when cleared, and take their memory from
+     * the given resource, such as the FrameArena of the frame.
+     */
+    struct DetectionBatch {
+        std::pmr::vector<cv::Rect> boxes; /**< In frame pixels. */
+        std::pmr::vector<int> classIds; /**< Indices into kClasses. */
+        std::pmr::vector<float> confidences;
+        std::pmr::vector<nx::sdk::Uuid> trackIds; /**< Null until assigned by ObjectTracker. */
+        std::pmr::vector<int> labels; /**< Classifier class ids; kUnknownClassification until classified. */
+
+        DetectionBatch() = default;
+
+        explicit DetectionBatch(std::pmr::memory_resource *memory) :
+                boxes(memory),
+                classIds(memory),
+                confidences(memory),
+                trackIds(memory),
+                labels(memory) {
+        }
+
+        size_t size() const { return boxes.size(); }
+
+        bool empty() const { return boxes.empty(); }
+
+        void clear() {
+            boxes.clear();
+            classIds.clear();
+            confidences.clear();
+            trackIds.clear();
+            labels.clear();
+        }
+
+        void reserve(size_t capacity) {
+            boxes.reserve(capacity);
+            classIds.reserve(capacity);
+            confidences.reserve(capacity);
+            trackIds.reserve(capacity);
+            labels.reserve(capacity);
+        }
+
+        void push_back(
+                const cv::Rect &box,
+                int classId,
+                float confidence,
+                const nx::sdk::Uuid &trackId = nx::sdk::Uuid(),
+                int label = kUnknownClassification) {
+            boxes.push_back(box);
+            classIds.push_back(classId);
+            confidences.push_back(confidence);
+            trackIds.push_back(trackId);
+            labels.push_back(label);
+        }
+    };
 }
\ No newline at end of file
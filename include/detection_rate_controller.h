@@ -0,0 +1,61 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace nx_meta_plugin {
+
+/**
+ * Chooses the frames of one camera to run detection on, by their timestamps, so that detection
+ * runs at a given rate per second whatever the frame rate of the camera.
+ *
+ * The rate actually used starts at the target rate and adapts to what the host can sustain:
+ * additive increase while the pipeline keeps up, multiplicative decrease when frames queue up in
+ * front of the pipeline or its latency exceeds kMaxLatency. It never goes above the target rate.
+ *
+ * selectFrame() is called from the Server thread and onFrameAnalyzed() from the pipeline thread.
+ */
+    class DetectionRateController {
+    public:
+        /** Latency above which the pipeline is considered overloaded. */
+        static constexpr std::chrono::milliseconds kMaxLatency{500};
+
+        static constexpr double kMinRateHz = 1;
+
+    public:
+        explicit DetectionRateController(double targetRateHz);
+
+        void setTargetRate(double targetRateHz);
+
+        /** @return Rate at which frames are currently selected, in frames per second. */
+        double rateHz() const { return m_rateHz; }
+
+        /** @return Whether detection should run on the frame with this timestamp. */
+        bool selectFrame(int64_t timestampUs);
+
+        /**
+         * Adapt the rate to the state of the pipeline after a selected frame has been analyzed.
+         *
+         * @param latency Time from selecting the frame until its metadata was ready.
+         * @param queuedFrames Selected frames still waiting in the pipeline queues.
+         */
+        void onFrameAnalyzed(std::chrono::microseconds latency, size_t queuedFrames);
+
+    private:
+        // Used only by selectFrame().
+        int64_t m_lastTimestampUs = -1;
+        int64_t m_nextSelectionUs = 0;
+        double m_frameIntervalUs = 0; /**< Average interval between the frames of the camera. */
+
+        // Used only by onFrameAnalyzed().
+        size_t m_decreaseHoldoff = 0; /**< Frames to analyze before the rate may decrease again. */
+
+        std::atomic<double> m_targetRateHz;
+        std::atomic<double> m_rateHz;
+    };
+
+}
@@ -2,14 +2,29 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <nx/sdk/analytics/helpers/object_metadata_packet.h>
 #include <nx/sdk/analytics/helpers/consuming_device_agent.h>
 #include <nx/sdk/helpers/uuid_helper.h>
 #include <nx/sdk/ptr.h>
 
+#include "allocation_counter.h"
+#include "bounded_queue.h"
+#include "detection_rate_controller.h"
 #include "engine.h"
+#include "frame_memory.h"
+#include "pipeline_channel.h"
+#include "scene_gate.h"
+#include "settings.h"
+#include "tiling.h"
+#include "tracking_stage.h"
 #include "yolo11_detector.h"
 #include "yolo11_classifier.h"
 #include "object_tracker.h"
@@ -17,11 +32,9 @@
 
 namespace nx_meta_plugin {
     class DeviceAgent : public nx::sdk::analytics::ConsumingDeviceAgent {
-    public:
-        using MetadataPacketList = std::vector<nx::sdk::Ptr < nx::sdk::analytics::IMetadataPacket>>;
-
     public:
         DeviceAgent(
+                Engine *engine,
                 const nx::sdk::IDeviceInfo *deviceInfo,
                 std::filesystem::path pluginHomeDir);
 
@@ -36,46 +49,163 @@ namespace nx_meta_plugin {
                 nx::sdk::Result<void> *outValue,
                 const nx::sdk::analytics::IMetadataTypes *neededMetadataTypes) override;
 
+        virtual nx::sdk::Result<const nx::sdk::ISettingsResponse *> settingsReceived() override;
+
     private:
-        void reinitializeObjectTrackerOnFrameSizeChanges(const Frame &frame);
+        /** Frame held by reference until the pipeline has analyzed it. */
+        struct QueuedFrame {
+            nx::sdk::Ptr<const nx::sdk::analytics::IUncompressedVideoFrame> videoFrame;
+            int64_t index = 0;
+            std::chrono::steady_clock::time_point selectedAt;
+        };
+
+        /** Output of the detection stage; the frame is still needed for the classifier crops. */
+        struct DetectedFrame {
+            nx::sdk::Ptr<const nx::sdk::analytics::IUncompressedVideoFrame> videoFrame;
+            int64_t index = 0;
+            std::chrono::steady_clock::time_point selectedAt;
+            FrameMemory *memory = nullptr; /**< Holds the detections, and the tracked ones later. */
+        };
+
+        enum class FrameDropPolicy {
+            dropOldest, /**< Make room for the new frame by dropping the oldest queued one. */
+            dropNewest, /**< Drop the new frame; the queued frames are analyzed first. */
+        };
 
-        nx::sdk::Ptr <nx::sdk::analytics::IMetadataPacket> generateEventMetadataPacket();
+    private:
+        void enqueueFrame(QueuedFrame queuedFrame);
+
+        void runDetectionStage();
+
+        void runTrackingStage();
+
+        SceneGate::Decision checkSceneGate(const Frame &frame);
+
+        bool selectRegions(const Frame &frame, SceneGate::Decision decision);
+
+        void predictTrackedRegions(const Frame &frame);
+
+        bool selectTrackedRegions(const Frame &frame);
+
+        bool selectMotionRegions(const Frame &frame);
+
+        bool selectTiles(const Frame &frame, SceneGate::Decision decision);
 
-        nx::sdk::Ptr <nx::sdk::analytics::ObjectMetadataPacket> detectionsToObjectMetadataPacket(
-                const DetectionList &detections,
-                int64_t timestampUs);
+        void countDetectionRegions(const cv::Size &frameSize);
 
-        MetadataPacketList processFrame(
-                const nx::sdk::analytics::IUncompressedVideoFrame *videoFrame);
+        void reportDroppedFrames();
+
+        void reportAllocations();
+
+        nx::sdk::Ptr <nx::sdk::analytics::IMetadataPacket> generateEventMetadataPacket();
+
+        nx::sdk::Ptr<nx::sdk::analytics::ObjectMetadataPacket> trackAndClassify(const DetectedFrame &detectedFrame);
 
     private:
-        const std::string kPersonObjectType = "nx.base.Person";
-        const std::string kCatObjectType = "nx.base.Cat";
-        const std::string kDogObjectType = "nx.base.Dog";
         const std::string kNewTrackEventType = "nx.sample.newTrack";
 
         /** Length of the the track (in frames). The value was chosen arbitrarily. */
         static constexpr int kTrackFrameCount = 256;
 
-        /** Should work on modern PCs. */
-        static constexpr int kDetectionFramePeriod = 2;
+        /** Frames waiting for analysis at most; absorbs short inference stalls. */
+        static constexpr size_t kFrameQueueCapacity = 4;
+
+        /**
+         * Frames detected but not yet tracked at most. One frame is enough for the stages to
+         * overlap; a second one absorbs the jitter of the classifier.
+         */
+        static constexpr size_t kDetectedFrameQueueCapacity = 2;
+
+        /**
+         * One frame is being detected, as many as the queue holds (its capacity is rounded up) are
+         * queued, and one is being tracked. The detection stage takes the memories in turn, so
+         * when it takes one, the frame which used it last has been tracked already.
+         */
+        static constexpr size_t kFrameMemoryCount = boundedQueueCapacity(kDetectedFrameQueueCapacity) + 2;
+
+        /**
+         * Predicted boxes of the tracked objects are grown by this fraction of their size on each
+         * side, for the error of the prediction.
+         */
+        static constexpr float kTrackedRegionMargin = 0.25f;
+
+        /** Scene gate counters are printed every kSceneGateReportPeriod checked frames. */
+        static constexpr uint64_t kSceneGateReportPeriod = 1000;
+
+        /** Allocations are printed every kAllocationReportPeriod analyzed frames, if counted. */
+        static constexpr uint64_t kAllocationReportPeriod = 1000;
+
+        /** Dropped frames are printed every kDroppedFramesReportPeriod enqueued frames. */
+        static constexpr uint64_t kDroppedFramesReportPeriod = 1000;
 
     private:
-        bool m_terminated = false;
-        bool m_terminatedPrevious = false;
+        Engine *const m_engine;
+        std::atomic<bool> m_terminated{false}; /**< Set by the Server and the pipeline threads. */
+        std::atomic<bool> m_terminatedPrevious{false};
+        std::atomic<bool> m_modelsInitialized{false}; /**< Frames are not queued before. */
         const std::unique_ptr<YOLO11Detector> m_objectDetector;
         const std::unique_ptr<YOLO11Classifier> m_objectClassifier;
-        std::unique_ptr<ObjectTracker> m_objectTracker;
+        TrackingStage m_trackingStage{m_objectClassifier.get()};
+        std::atomic<TrackerType> m_trackerType{TrackerType::tbm}; /**< Set by the Server thread. */
+        std::atomic<int> m_classificationIntervalS{kDefaultClassificationIntervalS};
+        AllocationMonitor m_allocationMonitor; /**< Used only by m_trackingThread. */
+        bool m_allocationMonitorStarted = false;
         int m_frameIndex = 0; /**< Used for generating the detection in the right place. */
+
+        /** Selects the frames to analyze by their timestamps; adapts to the pipeline load. */
+        DetectionRateController m_detectionRateController{kDefaultTargetDetectionRate};
         int m_trackIndex = 0; /**< Used in the description of the events. */
 
         // Used for checking whether the frame size changed, and for reinitializing the tracker.
         int64_t m_lastVideoFrameTimestampUs = 0;
 
-        /** Used for checking whether frame size changed and reinitializing the tracker. */
-
-        int m_previousFrameWidth = 0;
-        int m_previousFrameHeight = 0;
+        // Frames are analyzed by a two-stage pipeline, so that frame N+1 is letterboxed and
+        // inferred while frame N is being tracked and classified:
+        // - pushUncompressedVideoFrame() puts the frames into m_frameQueue, never waiting;
+        // - m_detectionThread runs the detector on them and puts the results into
+        //     m_detectedFrameQueue, waiting while it is full;
+        // - m_trackingThread runs m_trackingStage on them, and pushes the metadata.
+        // Each queue has one producer and one consumer, so the frames stay in order, and only
+        // m_trackingThread runs the tracker. The drop-oldest policy pops m_frameQueue from
+        // the Server thread as well, which BoundedQueue supports.
+        PipelineChannel<QueuedFrame> m_frameQueue{kFrameQueueCapacity};
+        PipelineChannel<DetectedFrame> m_detectedFrameQueue{kDetectedFrameQueueCapacity};
+        std::array<FrameMemory, kFrameMemoryCount> m_frameMemory;
+        size_t m_nextFrameMemory = 0; /**< Used only by m_detectionThread. */
+        std::atomic<FrameDropPolicy> m_frameDropPolicy{FrameDropPolicy::dropOldest};
+        std::atomic<uint64_t> m_enqueuedFrameCount{0};
+        std::atomic<uint64_t> m_droppedOldestFrameCount{0};
+        std::atomic<uint64_t> m_droppedNewestFrameCount{0};
+        bool m_dropReported = false; /**< Used only by the Server thread. */
+
+        // Skips the detector on unchanged frames; used only by m_detectionThread.
+        SceneGate m_sceneGate;
+        SceneGate::Decision m_lastSceneGateDecision = SceneGate::Decision::detect;
+        std::atomic<bool> m_sceneGatingEnabled{kDefaultSkipUnchangedFrames};
+
+        // Detection on parts of the frame: crops around the tracked objects between keyframes,
+        // crops around the moving and tracked objects, or the tiles which contain any. Keyframes
+        // and scene gate refreshes are detected whole (all the tiles).
+        std::atomic<int> m_keyframeInterval{kDefaultDetectionKeyframeInterval};
+        std::atomic<bool> m_motionRegionsEnabled{kDefaultDetectMotionRegionsOnly};
+        std::atomic<int> m_fullFrameDetectionIntervalS{kDefaultFullFrameDetectionIntervalS};
+        std::mutex m_tileLayoutMutex;
+        TileLayout m_tileLayout; /**< Set by the Server thread. */
+
+        // Used only by m_detectionThread.
+        std::vector<TrackMotion> m_trackMotions; /**< Copied from m_trackingStage. */
+        std::vector<cv::Rect> m_detectionRegions; /**< Empty to detect on the whole frame. */
+        std::vector<cv::Rect> m_trackedRegions; /**< Predicted for the frame, in frame pixels. */
+        std::vector<cv::Rect> m_changedRegions;
+        int m_framesSinceKeyframe = 0;
+        uint64_t m_tileCount = 0;
+        uint64_t m_skippedTileCount = 0;
+        uint64_t m_regionFrameCount = 0;
+        double m_regionAreaFractionSum = 0;
+
+        // Declared last to start after all the members they use.
+        std::thread m_detectionThread;
+        std::thread m_trackingThread;
     };
 
 }
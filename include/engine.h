@@ -2,12 +2,17 @@
 
 #pragma once
 
+#include <atomic>
 #include <filesystem>
+#include <memory>
 
 #include <nx/sdk/analytics/helpers/plugin.h>
 #include <nx/sdk/analytics/helpers/engine.h>
 #include <nx/sdk/analytics/i_uncompressed_video_frame.h>
 
+#include "inference_scheduler.h"
+#include "model_registry.h"
+
 namespace nx_meta_plugin {
 
     class Engine : public nx::sdk::analytics::Engine {
@@ -16,9 +21,25 @@ namespace nx_meta_plugin {
 
         virtual ~Engine() override;
 
+        const std::shared_ptr<ModelRegistry> &modelRegistry() const { return m_modelRegistry; }
+
+        const std::shared_ptr<InferenceScheduler> &inferenceScheduler() const { return m_inferenceScheduler; }
+
+        /** @return Options for the models loaded by new DeviceAgents, as set in the Engine settings. */
+        ModelOptions modelOptions() const;
+
+        void onDeviceAgentCreated();
+
+        void onDeviceAgentDestroyed();
+
+        /** Print the memory used by the process per attached camera and the model registry state. */
+        void reportMemoryUsage() const;
+
     protected:
         virtual std::string manifestString() const override;
 
+        virtual nx::sdk::Result<const nx::sdk::ISettingsResponse *> settingsReceived() override;
+
     protected:
         virtual void doObtainDeviceAgent(
                 nx::sdk::Result<nx::sdk::analytics::IDeviceAgent *> *outResult,
@@ -26,6 +47,10 @@ namespace nx_meta_plugin {
 
     private:
         std::filesystem::path m_pluginHomeDir;
+        const std::shared_ptr<ModelRegistry> m_modelRegistry = std::make_shared<ModelRegistry>();
+        const std::shared_ptr<InferenceScheduler> m_inferenceScheduler = std::make_shared<InferenceScheduler>();
+        std::atomic<int> m_deviceAgentCount{0};
+        std::atomic<bool> m_preferInt8Models{false};
     };
 
 }
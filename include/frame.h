@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <utility>
+
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc.hpp>
 
@@ -33,6 +36,15 @@ namespace nx_meta_plugin {
                     /*_data*/ (void *) frame->data(0),
                     /*_step*/ (size_t) frame->lineSize(0));
         }
+
+        /** Frame which does not come from the Server, such as a replayed one. */
+        Frame(cv::Mat image, int64_t timestampUs, int64_t index) :
+                width(image.cols),
+                height(image.rows),
+                timestampUs(timestampUs),
+                index(index),
+                cvMat(std::move(image)) {
+        }
     };
 
 }
@@ -0,0 +1,74 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace nx_meta_plugin {
+
+/**
+ * Monotonic memory for the containers which live as long as one frame in the pipeline.
+ *
+ * Allocating bumps an offset in a retained block, deallocating does nothing, and reset() frees
+ * everything at once. What does not fit into the block is taken from the heap until the next
+ * reset(), which then grows the block to all the frame took; so once a scene has been seen, its
+ * frames are served from the block alone.
+ *
+ * Not thread-safe: a frame is handled by one pipeline thread at a time.
+ */
+    class FrameArena: public std::pmr::memory_resource {
+    public:
+        struct Stats {
+            uint64_t frames = 0; /**< Number of reset() calls. */
+            uint64_t overflowedFrames = 0; /**< Frames which did not fit into the block. */
+        };
+
+    public:
+        explicit FrameArena(size_t initialCapacity = kDefaultInitialCapacity);
+
+        virtual ~FrameArena() override;
+
+        FrameArena(const FrameArena &) = delete;
+        FrameArena &operator=(const FrameArena &) = delete;
+
+        /** Free all the memory taken from the arena; the containers using it must be empty. */
+        void reset();
+
+        size_t capacity() const { return m_capacity; }
+
+        const Stats &stats() const { return m_stats; }
+
+    protected:
+        virtual void *do_allocate(size_t bytes, size_t alignment) override;
+
+        virtual void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+
+        virtual bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+    private:
+        /** Allocation taken from the heap because it did not fit into the block. */
+        struct Overflow {
+            void *p = nullptr;
+            size_t bytes = 0;
+            size_t alignment = 0;
+        };
+
+    private:
+        void freeOverflows();
+
+    private:
+        static constexpr size_t kDefaultInitialCapacity = 16 * 1024;
+
+        std::unique_ptr<std::byte[]> m_block;
+        size_t m_capacity = 0;
+        size_t m_used = 0;
+        size_t m_overflowBytes = 0;
+        std::vector<Overflow> m_overflows;
+        Stats m_stats;
+    };
+
+}
@@ -0,0 +1,31 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include "detection.h"
+#include "frame_arena.h"
+
+namespace nx_meta_plugin {
+
+/**
+ * Memory of one frame from its detection until its metadata is pushed. The detection and the
+ * tracking stages of a DeviceAgent work on different frames at once, so each frame in the pipeline
+ * has its own, and it is handed over from stage to stage with the frame.
+ */
+    struct FrameMemory {
+        FrameArena arena;
+        DetectionBatch detections{&arena};
+        DetectionBatch trackedDetections{&arena};
+
+        /**
+         * Free the memory of the previous frame. The batches give their arrays back first, as
+         * those point into the arena.
+         */
+        void reset() {
+            detections = DetectionBatch(&arena);
+            trackedDetections = DetectionBatch(&arena);
+            arena.reset();
+        }
+    };
+
+}
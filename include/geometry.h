@@ -125,12 +125,6 @@ namespace nx_meta_plugin {
 
     size_t vectorProduct(const std::vector<int64_t> &vector);
 
-    void NMSBoxes(const std::vector<cv::Rect> &boundingBoxes,
-                  const std::vector<float> &scores,
-                  float scoreThreshold,
-                  float nmsThreshold,
-                  std::vector<int> &indices);
-
     cv::Rect scaleCoords(const cv::Size &imageShape, cv::Rect coords,
                          const cv::Size &imageOriginalShape, bool p_Clip);
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace nx_meta_plugin {
+
+/**
+ * Fixed-bucket histogram for runtime statistics. Not thread-safe: the owner is responsible for
+ * locking.
+ */
+    class Histogram {
+    public:
+        /** @param upperBounds Inclusive upper bounds of the buckets, in ascending order. */
+        explicit Histogram(std::vector<double> upperBounds) :
+                m_upperBounds(std::move(upperBounds)),
+                m_counts(m_upperBounds.size() + 1, 0) {
+        }
+
+        void add(double value) {
+            const auto bucket = std::lower_bound(m_upperBounds.begin(), m_upperBounds.end(), value);
+            ++m_counts[(size_t) (bucket - m_upperBounds.begin())];
+            ++m_totalCount;
+            m_sum += value;
+        }
+
+        uint64_t count() const { return m_totalCount; }
+
+        double mean() const { return m_totalCount == 0 ? 0.0 : m_sum / (double) m_totalCount; }
+
+        void reset() {
+            std::fill(m_counts.begin(), m_counts.end(), 0);
+            m_totalCount = 0;
+            m_sum = 0;
+        }
+
+        /** @return Human-readable representation, e.g. "<=1: 10, <=2: 3, >2: 0". */
+        std::string toString() const {
+            std::ostringstream result;
+            for (size_t i = 0; i < m_upperBounds.size(); ++i)
+                result << "<=" << m_upperBounds[i] << ": " << m_counts[i] << ", ";
+            result << ">" << (m_upperBounds.empty() ? 0.0 : m_upperBounds.back()) << ": " << m_counts.back();
+            return result.str();
+        }
+
+    private:
+        const std::vector<double> m_upperBounds;
+        std::vector<uint64_t> m_counts;
+        uint64_t m_totalCount = 0;
+        double m_sum = 0;
+    };
+
+}
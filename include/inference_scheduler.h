@@ -0,0 +1,176 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bound_session.h"
+#include "histogram.h"
+#include "model_registry.h"
+
+namespace nx_meta_plugin {
+
+/**
+ * Engine-wide scheduler which merges inference requests coming from different DeviceAgents into
+ * batches. A batch is started when it is full or when the oldest request has waited for the
+ * configured time, so the latency added to each frame is bounded by the wait time plus the
+ * duration of one batched Session::Run().
+ *
+ * Only requests for the same session and with the same input shape are batched together, and only
+ * models with a dynamic batch dimension can be batched at all.
+ *
+ * The batch is run through a BoundSession, and every request has a slot of its input and of its
+ * output: the caller letterboxes its image straight into the input slot and decodes its detections
+ * straight from the output slot, so no tensor is copied. Two sets of buffers are used in turns, so
+ * that a batch can run while the callers of the previous one are still reading their output.
+ */
+    class InferenceScheduler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Options {
+            int maxBatchSize = 8;
+            std::chrono::microseconds maxWait{5000};
+        };
+
+    public:
+        InferenceScheduler();
+
+        ~InferenceScheduler();
+
+        void setOptions(const Options &options);
+
+        /** @return Whether requests for the given session would be batched at all. */
+        bool isBatchingEnabled(const ModelSession &session) const;
+
+        /**
+         * Run the model on a single input, blocking until the batch this input was put into is
+         * processed. Both callbacks are called on the calling thread. Throws the exception thrown
+         * by Session::Run() or by a callback, if any.
+         *
+         * @param inputShape Shape of the single input, with the batch dimension equal to 1.
+         * @param writeInput Called as writeInput(float *input) once the request is in a batch, to
+         *     fill the slot of the batch input, of inputShape.
+         * @param readOutput Called as readOutput(const float *output, const std::vector<int64_t>
+         *     &outputShape) once the batch is processed, with the slot of the batch output and its
+         *     shape, with the batch dimension equal to 1. Both are valid only during the call.
+         */
+        template<typename WriteInput, typename ReadOutput>
+        void run(
+                const std::shared_ptr<ModelSession> &session,
+                const std::vector<int64_t> &inputShape,
+                WriteInput &&writeInput,
+                ReadOutput &&readOutput);
+
+    private:
+        /** The caller side of a request. */
+        class Client {
+        public:
+            virtual ~Client() = default;
+
+            virtual void writeInput(float *input) = 0;
+
+            virtual void readOutput(const float *output, const std::vector<int64_t> &outputShape) = 0;
+        };
+
+        enum class RequestState {
+            queued,
+            writing, /**< Has an input slot, which the caller is filling. */
+            written,
+            done, /**< Processed, or failed; the caller is reading its output slot. */
+            released,
+        };
+
+        /** Bound buffers of one batch, with a slot of the input and of the output per request. */
+        struct BatchBuffers {
+            std::weak_ptr<ModelSession> session; /**< Which boundSession is bound to. */
+            std::unique_ptr<BoundSession> boundSession;
+            std::vector<int64_t> requestOutputShape; /**< With the batch dimension equal to 1. */
+            size_t unwrittenCount = 0;
+            size_t unreleasedCount = 0; /**< The buffers are reused only once this is 0. */
+        };
+
+        struct Request {
+            const std::shared_ptr<ModelSession> *session = nullptr;
+            const std::vector<int64_t> *inputShape = nullptr;
+            Clock::time_point enqueuedAt;
+            RequestState state = RequestState::queued;
+            BatchBuffers *buffers = nullptr;
+            float *input = nullptr;
+            const float *output = nullptr;
+            std::exception_ptr error;
+        };
+
+        void run(
+                const std::shared_ptr<ModelSession> &session,
+                const std::vector<int64_t> &inputShape,
+                Client *client);
+
+        void processBatches();
+
+        bool isCompatible(const Request &first, const Request &other) const;
+
+        size_t countCompatibleRequests() const;
+
+        float *prepareBatchInput(BatchBuffers *buffers, const std::vector<Request *> &batch);
+
+        void finishBatch(BatchBuffers *buffers, const std::exception_ptr &error);
+
+        void reportStats();
+
+    private:
+        mutable std::mutex m_mutex;
+        std::condition_variable m_submitted;
+        std::condition_variable m_completed;
+        std::deque<Request *> m_queue;
+        Options m_options;
+        bool m_stopped = false;
+
+        // Used only by the scheduler thread, besides the counters of the buffers.
+        std::vector<Request *> m_batch;
+        std::array<BatchBuffers, 2> m_buffers;
+        size_t m_nextBuffers = 0;
+
+        Histogram m_batchSizeHistogram{{1, 2, 4, 8, 16}};
+        Histogram m_waitTimeMsHistogram{{0.5, 1, 2, 5, 10, 20}};
+
+        std::thread m_thread;
+    };
+
+    template<typename WriteInput, typename ReadOutput>
+    void InferenceScheduler::run(
+            const std::shared_ptr<ModelSession> &session,
+            const std::vector<int64_t> &inputShape,
+            WriteInput &&writeInput,
+            ReadOutput &&readOutput) {
+        class Callbacks : public Client {
+        public:
+            Callbacks(WriteInput &writeInput, ReadOutput &readOutput) :
+                    m_writeInput(writeInput),
+                    m_readOutput(readOutput) {
+            }
+
+            virtual void writeInput(float *input) override { m_writeInput(input); }
+
+            virtual void readOutput(const float *output, const std::vector<int64_t> &outputShape) override {
+                m_readOutput(output, outputShape);
+            }
+
+        private:
+            WriteInput &m_writeInput;
+            ReadOutput &m_readOutput;
+        };
+
+        Callbacks callbacks(writeInput, readOutput);
+        run(session, inputShape, &callbacks);
+    }
+
+}
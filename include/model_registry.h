@@ -0,0 +1,129 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <onnxruntime_cxx_api.h>
+#include <opencv2/core/core.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nx_meta_plugin {
+
+/**
+ * Options which affect how an ONNX Runtime session is created. Sessions are shared only between
+ * users that request the same model with the same options.
+ */
+    struct ModelOptions {
+        int intraOpNumThreads = 0; /**< 0 means "choose automatically". */
+        bool useGpu = false;
+
+        /**
+         * Load the statically quantized INT8 variant of the model (`<name>.int8.onnx` next to
+         * `<name>.onnx`) if it exists.
+         */
+        bool preferInt8 = false;
+
+        std::string key() const;
+    };
+
+/**
+ * An ONNX Runtime session together with the model properties that every user of the model needs.
+ * Instances are created by ModelRegistry and shared between all DeviceAgents. Ort::Session::Run()
+ * is thread-safe, so the session can be used concurrently without additional locking.
+ */
+    struct ModelSession {
+        std::filesystem::path modelPath;
+        Ort::Session session{nullptr};
+        bool isDynamicInputShape = false;              // Flag indicating if input shape is dynamic
+        bool isDynamicBatchSize = false;               // Flag indicating if several inputs can be batched
+        cv::Size inputImageShape;                      // Expected input image shape for the model
+
+        // Vectors to hold allocated input and output node names
+        std::vector<Ort::AllocatedStringPtr> inputNodeNameAllocatedStrings;
+        std::vector<const char *> inputNames;
+        std::vector<Ort::AllocatedStringPtr> outputNodeNameAllocatedStrings;
+        std::vector<const char *> outputNames;
+
+        size_t numInputNodes = 0;                      // Number of input nodes in the model
+        size_t numOutputNodes = 0;                     // Number of output nodes in the model
+    };
+
+/**
+ * Engine-wide, reference-counted cache of ONNX Runtime sessions keyed by model path and options.
+ *
+ * All sessions are created in a single Ort::Env, use the allocator registered in that Env and
+ * share one container of prepacked weights, so attaching one more camera does not load one more
+ * copy of the model. A session which has no users is kept for the idle timeout, so that a camera
+ * which is re-attached does not have to load the model again, and is destroyed afterwards.
+ */
+    class ModelRegistry : public std::enable_shared_from_this<ModelRegistry> {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Stats {
+            size_t sessionCount = 0; /**< Sessions that are currently loaded. */
+            size_t handleCount = 0; /**< Handles that are currently held by the users. */
+            uintmax_t modelFileBytes = 0; /**< Total size of the loaded model files. */
+        };
+
+    public:
+        ModelRegistry();
+
+        ~ModelRegistry();
+
+        /**
+         * @return Handle to the session for the given model. The session is loaded if it is not
+         *     loaded yet. The session stays alive at least as long as the handle. Throws on errors.
+         */
+        std::shared_ptr<ModelSession> acquire(
+                const std::filesystem::path &modelPath,
+                const ModelOptions &options);
+
+        void setIdleTimeout(std::chrono::seconds idleTimeout);
+
+        /**
+         * @return Path of the INT8 variant of the model if it is preferred and exists, the given
+         *     path otherwise.
+         */
+        static std::filesystem::path resolveModelPath(
+                const std::filesystem::path &modelPath,
+                const ModelOptions &options);
+
+        Stats stats() const;
+
+    private:
+        struct Entry {
+            std::shared_ptr<ModelSession> session;
+            int handleCount = 0;
+            Clock::time_point idleSince;
+        };
+
+        std::shared_ptr<ModelSession> loadSession(
+                const std::filesystem::path &modelPath,
+                const ModelOptions &options);
+
+        void release(const std::string &key);
+
+        void evictIdleSessions();
+
+    private:
+        Ort::Env m_env{nullptr};
+        Ort::PrepackedWeightsContainer m_prepackedWeights;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::map<std::string, Entry> m_entries;
+        std::chrono::seconds m_idleTimeout{60};
+        bool m_stopped = false;
+        std::thread m_evictionThread;
+    };
+
+}
@@ -0,0 +1,77 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nx_meta_plugin {
+
+/**
+ * Boxes for NMS in structure-of-arrays layout, so that the IoU of one box against many others can
+ * be computed with SIMD loads. Coordinates are corners: (x1, y1) top-left, (x2, y2) bottom-right.
+ */
+    struct NmsBoxes {
+        std::vector<float> x1;
+        std::vector<float> y1;
+        std::vector<float> x2;
+        std::vector<float> y2;
+        std::vector<float> scores;
+        std::vector<int32_t> classIds;
+
+        size_t size() const { return scores.size(); }
+
+        void clear();
+
+        void reserve(size_t capacity);
+
+        void push_back(float left, float top, float right, float bottom, float score, int32_t classId);
+    };
+
+    struct NmsOptions {
+        size_t topK = 300; /**< Boxes per class considered at all; 0 means no limit. */
+        size_t maxDetections = 100; /**< Boxes returned at most; 0 means no limit. */
+    };
+
+/**
+ * Greedy per-class non-maximum suppression with a bounded amount of work per frame.
+ *
+ * Boxes are put into per-class buckets with a counting sort, so boxes of different classes never
+ * suppress each other and no coordinate offsets are needed. Of each bucket only the topK best
+ * boxes are sorted and compared, and a bucket stops as soon as it has produced maxDetections
+ * boxes, so a crowded frame with hundreds of candidates costs at most O(classes * topK^2) IoU
+ * computations, done 8 (AVX2) or 4 (SSE2) at a time.
+ *
+ * Not thread-safe; each detector or classifier owns its own instance.
+ */
+    class NmsEngine {
+    public:
+        explicit NmsEngine(const NmsOptions &options = NmsOptions());
+
+        /**
+         * @return Indices of the boxes kept, by descending score. Valid until the next call.
+         */
+        const std::vector<int32_t> &run(const NmsBoxes &boxes, float iouThreshold);
+
+    private:
+        void suppressBucket(
+                const NmsBoxes &boxes,
+                std::vector<int32_t>::iterator begin,
+                std::vector<int32_t>::iterator end,
+                float iouThreshold);
+
+    private:
+        const NmsOptions m_options;
+
+        std::vector<int32_t> m_order; /**< Box indices grouped by class. */
+        std::vector<size_t> m_bucketStarts;
+        std::vector<int32_t> m_kept;
+
+        // The boxes of the current bucket, by descending score.
+        NmsBoxes m_bucket;
+        std::vector<float> m_areas;
+        std::vector<int32_t> m_suppressed; /**< All bits set for the suppressed boxes. */
+    };
+
+}
@@ -27,12 +27,12 @@ namespace nx_meta_plugin {
 
         void terminate();
 
-        DetectionList run(const Frame &frame);
+        DetectionBatch run(const Frame &frame);
 
     private:
         void loadModel();
 
-        DetectionList runImpl(const Frame &frame);
+        DetectionBatch runImpl(const Frame &frame);
 
     private:
         bool m_netLoaded = false;
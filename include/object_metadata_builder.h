@@ -0,0 +1,92 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+
+#include <nx/sdk/analytics/helpers/object_metadata.h>
+#include <nx/sdk/analytics/helpers/object_metadata_packet.h>
+#include <nx/sdk/ptr.h>
+#include <nx/sdk/uuid.h>
+
+#include "detection.h"
+#include "frame.h"
+
+namespace nx_meta_plugin {
+
+    constexpr const char *kPersonObjectType = "nx.base.Person";
+    constexpr const char *kCatObjectType = "nx.base.Cat";
+    constexpr const char *kDogObjectType = "nx.base.Dog";
+
+    constexpr std::array<const char *, kClasses.size()> makeObjectTypes() {
+        std::array<const char *, kClasses.size()> result{};
+        result[kPersonClassId] = kPersonObjectType;
+        result[kCatClassId] = kCatObjectType;
+        result[kDogClassId] = kDogObjectType;
+        return result;
+    }
+
+    /** Object type ids of the detector classes, indexed by class id; null for the classes not reported. */
+    constexpr std::array<const char *, kClasses.size()> kObjectTypes = makeObjectTypes();
+
+/**
+ * Builds the object metadata packets of the tracked detections. Building a packet takes almost no
+ * work per object: the object types come from kObjectTypes, the attributes of every classifier
+ * label are created once, the TrackID attribute once per track, and the ObjectMetadata of a track
+ * is reused on the next frame if the Server has released it and the label has not changed.
+ *
+ * Not thread-safe; used only by the tracking thread of a DeviceAgent.
+ */
+    class ObjectMetadataBuilder {
+    public:
+        /** Tracks not seen for this long are forgotten. */
+        static constexpr int64_t kTrackLifetimeUs = 10'000'000;
+
+        /** Colors of the classified people, indexed by classifier class id. */
+        static constexpr std::array<const char *, kClassesToClassification.size()> kClassificationColors{
+                "Green", "Red"};
+        static constexpr const char *kUnknownClassificationColor = "Yellow";
+
+    public:
+        ObjectMetadataBuilder();
+
+        /** @return Null if there are no detections. */
+        nx::sdk::Ptr<nx::sdk::analytics::ObjectMetadataPacket> build(
+                const DetectionBatch &detections,
+                const Frame &frame);
+
+        void clear();
+
+    private:
+        /** Attributes of the people with a classifier label, shared by all of them. */
+        struct LabelAttributes {
+            nx::sdk::Ptr<nx::sdk::Attribute> type;
+            nx::sdk::Ptr<nx::sdk::Attribute> color;
+        };
+
+        struct Track {
+            nx::sdk::Ptr<nx::sdk::Attribute> trackIdAttribute;
+            nx::sdk::Ptr<nx::sdk::analytics::ObjectMetadata> objectMetadata;
+            int classId = -1;
+            int label = kUnknownClassification;
+            int64_t lastSeenUs = 0;
+        };
+
+    private:
+        nx::sdk::Ptr<nx::sdk::analytics::ObjectMetadata> objectMetadata(
+                const nx::sdk::Uuid &trackId,
+                int classId,
+                int label,
+                int64_t timestampUs);
+
+        void removeStale(int64_t timestampUs);
+
+    private:
+        /** Indexed by classifier class id + 1, so that kUnknownClassification comes first. */
+        std::array<LabelAttributes, kClassesToClassification.size() + 1> m_labelAttributes;
+        std::map<nx::sdk::Uuid, Track> m_tracks;
+    };
+
+}
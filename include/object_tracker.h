@@ -3,9 +3,9 @@
 #pragma once
 
 #include <algorithm>
-#include <map>
-
-#include <opencv2/tracking/tracking_by_matching.hpp>
+#include <chrono>
+#include <cstdint>
+#include <vector>
 
 #include <nx/sdk/helpers/uuid_helper.h>
 #include <nx/sdk/uuid.h>
@@ -13,24 +13,62 @@
 #include "detection.h"
 #include "frame.h"
 #include "object_tracker_utils.h"
+#include "tracker_backend.h"
 
 namespace nx_meta_plugin {
 
     using namespace std::chrono_literals;
 
+/**
+ * Assigns track ids (Uuids) to the detections of consecutive frames, with one of the tracker
+ * backends.
+ */
     class ObjectTracker {
     public:
-        ObjectTracker();
+        explicit ObjectTracker(TrackerType type = TrackerType::tbm);
+
+        TrackerType type() const { return m_type; }
+
+        /**
+         * Assign track ids to the detections of the frame.
+         *
+         * @param outTrackedDetections The detections which belong to a track, with their track
+         *     ids; cleared first, so that the caller can reuse it from frame to frame.
+         */
+        void run(const Frame &frame, const DetectionBatch &detections, DetectionBatch *outTrackedDetections);
+
+        /**
+         * Tell the tracker how many frames per second it is run on, so that tracks are forgotten
+         * after kForgetDelay whatever the detection rate.
+         */
+        void setDetectionRate(double rateHz);
 
-        DetectionList run(const Frame &frame, const DetectionList &detections);
+        /** @return Whether any track is still followed, i.e. has not been forgotten yet. */
+        bool hasActiveTracks() const;
+
+        /**
+         * @param outTrackMotions Motion of every track which is still followed; cleared first, so
+         *     that the caller can reuse it from frame to frame.
+         */
+        void trackMotions(std::vector<TrackMotion> *outTrackMotions) const;
 
     private:
-        DetectionList runImpl(const Frame &frame, const DetectionList &detections);
+        void runImpl(const Frame &frame, const DetectionBatch &detections, DetectionBatch *outTrackedDetections);
 
         void cleanupIds();
 
     private:
-        const cv::Ptr<cv::tbm::ITrackerByMatching> m_tracker;
+        /** Tracks not matched for this long are forgotten. */
+        static constexpr std::chrono::milliseconds kForgetDelay{5000};
+
+        /** Forget delay of the backends until the detection rate is set. */
+        static constexpr size_t kDefaultForgetDelayFrames = 75;
+
+    private:
+        const TrackerType m_type;
+        const std::unique_ptr<TrackerBackend> m_backend;
         const std::unique_ptr<IdMapper> m_idMapper = std::make_unique<IdMapper>();
+        size_t m_forgetDelayFrames = kDefaultForgetDelayFrames;
+        cv::tbm::TrackedObjects m_detectionsToTrack; /**< Reused from frame to frame. */
     };
 }
@@ -2,9 +2,9 @@
 
 #pragma once
 
-#include <map>
-#include <memory>
-#include <set>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 #include <opencv2/tracking/tracking_by_matching.hpp>
 
@@ -12,74 +12,68 @@
 #include <nx/sdk/uuid.h>
 
 #include "detection.h"
-#include "frame.h"
 
 namespace nx_meta_plugin {
 
 /**
  * Provides conversion from int ids coming from the tracker to Uuid ids that are needed by the
  * Server.
+ *
+ * The ids are kept in a flat open-addressing table, which allocates only when it grows. Every id
+ * is stamped with the generation (the frame) it was last used in, and the ids unused for longer
+ * than the tracker remembers its tracks are evicted, so the tracker need not list its tracks.
  */
     class IdMapper {
     public:
+        /** @return Uuid of the id, generated on the first call; marks the id as used. */
         nx::sdk::Uuid get(int64_t id);
 
-        void removeAllExcept(const std::set<int64_t> &idsToKeep);
+        /** Start the next generation; called once per frame. */
+        void nextGeneration() { ++m_generation; }
 
-    private:
-        std::map<int64_t, nx::sdk::Uuid> m_map;
-    };
-
-    struct DetectionInternal {
-        std::shared_ptr<Detection> detection;
-        int64_t cvTrackId;
-    };
+        /** Forget the ids not used in the last maxAge generations. */
+        void removeOlderThan(uint64_t maxAge);
 
-    using DetectionInternalList = std::vector<std::shared_ptr<DetectionInternal>>;
+        size_t size() const { return m_size; }
 
-    struct CompositeDetectionId {
-        const int64_t frameIndex;
-        const cv::Rect rect;
-    };
+    private:
+        struct Slot {
+            int64_t id = 0;
+            nx::sdk::Uuid uuid;
+            uint64_t generation = 0;
+            bool used = false;
+        };
 
-    using ClassLabelMap = std::map<const CompositeDetectionId, std::string>;
+    private:
+        size_t findSlot(int64_t id) const;
 
-    cv::tbm::TrackedObjects convertDetectionsToTrackedObjects(
-            const Frame &frame,
-            const DetectionList &detections,
-            ClassLabelMap *inOutClassLabels);
+        void rehash(size_t capacity, uint64_t maxAge);
 
-    std::shared_ptr<Detection> convertTrackedObjectToDetection(
-            const Frame &frame,
-            const cv::tbm::TrackedObject &trackedDetection,
-            const std::string &classLabel,
-            IdMapper *idMapper);
+    private:
+        /** Power of two; the table grows twice when it gets half full. */
+        static constexpr size_t kInitialCapacity = 64;
 
-    DetectionList convertTrackedObjectsToDetections(
-            const Frame &frame,
-            const cv::tbm::TrackedObjects &trackedDetections,
-            const ClassLabelMap &classLabels,
-            IdMapper *idMapper);
+        std::vector<Slot> m_slots = std::vector<Slot>(kInitialCapacity);
+        std::vector<Slot> m_rehashedSlots; /**< Kept to rehash without allocating. */
+        size_t m_size = 0;
+        uint64_t m_generation = 0;
+    };
 
-    DetectionList extractDetectionList(const DetectionInternalList &detectionsInternal);
+/**
+ * Convert detections from the plugin format to the format of cv::tbm into outTrackedObjects. The
+ * index of every detection is kept in frame_idx, which the tracker backends pass through, so
+ * that the tracked objects lead back to their detections.
+ */
+    void convertDetectionsToTrackedObjects(
+            const DetectionBatch &detections,
+            cv::tbm::TrackedObjects *outTrackedObjects);
 
-}
+/**
+ * @return Index of the detection the tracked object comes from, in the list the tracked objects
+ *     were converted from, or -1 if there is none.
+ */
+    int findDetectionIndex(
+            const cv::tbm::TrackedObject &trackedObject,
+            const cv::tbm::TrackedObjects &trackedDetections);
 
-namespace std {
-    using namespace nx_meta_plugin;
-
-    template<>
-    struct less<const CompositeDetectionId> {
-        bool operator()(const CompositeDetectionId &lhs, const CompositeDetectionId &rhs) const {
-            if (lhs.frameIndex != rhs.frameIndex)
-                return lhs.frameIndex < rhs.frameIndex;
-            if (lhs.rect.x != rhs.rect.x)
-                return lhs.rect.x < rhs.rect.x;
-            if (lhs.rect.y != rhs.rect.y)
-                return lhs.rect.y < rhs.rect.y;
-            if (lhs.rect.width != rhs.rect.width)
-                return lhs.rect.width < rhs.rect.width;
-            return lhs.rect.width < rhs.rect.width;
-        }
-    };
 }
@@ -0,0 +1,141 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "bounded_queue.h"
+
+namespace nx_meta_plugin {
+
+/**
+ * Connects two pipeline stages running on different threads: a BoundedQueue plus the means for
+ * the stages to sleep while it is empty or full. Items are passed without locking; the mutex is
+ * taken only by a stage going to sleep, and by the other stage to wake it up, so that no wake-up
+ * is lost. While neither stage sleeps, pushing and popping never lock.
+ *
+ * Items come out in the order they were pushed as long as there is one producer and one consumer.
+ */
+    template<typename T>
+    class PipelineChannel {
+    public:
+        explicit PipelineChannel(size_t capacity) :
+                m_queue(capacity) {
+        }
+
+        /** @return Number of values in the channel; approximate while it is in use. */
+        size_t size() const { return m_queue.size(); }
+
+        /** @return False if the channel is full; value is left untouched then. */
+        bool tryPush(T &value) {
+            if (!m_queue.tryPush(value))
+                return false;
+            wake(m_notEmpty, m_sleepingConsumers);
+            return true;
+        }
+
+        /** @return False if the channel is empty. */
+        bool tryPop(T *outValue) {
+            if (!m_queue.tryPop(outValue))
+                return false;
+            wake(m_notFull, m_sleepingProducers);
+            return true;
+        }
+
+        /**
+         * Wait until there is room for the value, and push it.
+         *
+         * @return False if the channel has been closed; value is left untouched then.
+         */
+        bool push(T &value) {
+            if (m_closed)
+                return false;
+            if (!tryPush(value)) {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                sleep(&lock, m_notFull, &m_sleepingProducers,
+                      [this, &value]() { return m_closed || m_queue.tryPush(value); });
+                if (m_closed)
+                    return false;
+                lock.unlock();
+                wake(m_notEmpty, m_sleepingConsumers);
+            }
+            return true;
+        }
+
+        /**
+         * Wait until there is a value, and pop it.
+         *
+         * @return False if the channel has been closed; the values left in it are not popped.
+         */
+        bool pop(T *outValue) {
+            if (m_closed)
+                return false;
+            if (!tryPop(outValue)) {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                sleep(&lock, m_notEmpty, &m_sleepingConsumers,
+                      [this, outValue]() { return m_closed || m_queue.tryPop(outValue); });
+                if (m_closed)
+                    return false;
+                lock.unlock();
+                wake(m_notFull, m_sleepingProducers);
+            }
+            return true;
+        }
+
+        /**
+         * Make the waiting and all the following push() and pop() calls return false, even while
+         * values are left in the channel; tryPush() and tryPop() still work.
+         */
+        void close() {
+            {
+                const std::lock_guard<std::mutex> lock(m_mutex);
+                m_closed = true;
+            }
+            m_notEmpty.notify_all();
+            m_notFull.notify_all();
+        }
+
+    private:
+        /**
+         * Wait on the condition until isDone() holds, counted among the sleepers meanwhile. The
+         * fence pairs with the one of wake(): either isDone() sees the value the other stage has
+         * just passed, or the other stage sees this one counted and wakes it up.
+         */
+        template<typename Predicate>
+        static void sleep(
+                std::unique_lock<std::mutex> *lock,
+                std::condition_variable &condition,
+                std::atomic<int> *sleepers,
+                Predicate isDone) {
+            sleepers->fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            condition.wait(*lock, isDone);
+            sleepers->fetch_sub(1);
+        }
+
+        /** Wake up a stage sleeping on the condition, if there is any. */
+        void wake(std::condition_variable &condition, const std::atomic<int> &sleepers) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleepers.load(std::memory_order_relaxed) == 0)
+                return;
+            {
+                // Taken only to not lose the wake-up of a stage which has checked the queue but
+                // not started waiting yet.
+                const std::lock_guard<std::mutex> lock(m_mutex);
+            }
+            condition.notify_one();
+        }
+
+    private:
+        BoundedQueue<T> m_queue;
+        std::mutex m_mutex;
+        std::condition_variable m_notEmpty;
+        std::condition_variable m_notFull;
+        std::atomic<int> m_sleepingConsumers{0}; /**< Waiting on m_notEmpty. */
+        std::atomic<int> m_sleepingProducers{0}; /**< Waiting on m_notFull. */
+        std::atomic<bool> m_closed{false}; /**< Set under m_mutex, so that no sleeper misses it. */
+    };
+
+}
@@ -0,0 +1,88 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace nx_meta_plugin {
+
+/**
+ * Letterbox transform of one source resolution to one model input resolution, with the bilinear
+ * interpolation coefficients precomputed for every column and row of the resized image.
+ */
+    struct LetterboxGeometry {
+        cv::Size sourceSize;
+        cv::Size outputSize; /**< Size of the tensor plane, including the padding. */
+        cv::Size resizedSize; /**< Size of the resized image inside the padding. */
+        int padLeft = 0;
+        int padTop = 0;
+
+        std::vector<int32_t> sourceByteX; /**< Byte offset of the left source pixel per column. */
+        std::vector<float> weightX; /**< Weight of the right source pixel per column. */
+        std::vector<int32_t> sourceY; /**< Upper source row per row. */
+        std::vector<float> weightY; /**< Weight of the lower source row per row. */
+    };
+
+/**
+ * @param autoPad Pad only up to the model stride, as letterBox() does with auto_ == true; otherwise
+ *     pad up to targetSize.
+ */
+    LetterboxGeometry makeLetterboxGeometry(
+            const cv::Size &sourceSize,
+            const cv::Size &targetSize,
+            bool autoPad,
+            int stride = 32);
+
+/**
+ * Converts a BGR uint8 image to a letterboxed, [0, 1]-normalized, planar CHW float tensor in one
+ * pass: every source row is read once, interpolated horizontally into a small scratch buffer, and
+ * blended vertically straight into the tensor. Produces the same result as letterBox() followed
+ * by convertTo() and split(), up to the rounding of the bilinear interpolation.
+ *
+ * The geometry is cached per source and target resolution, so for a camera stream it is computed
+ * once. Not thread-safe; each detector or classifier owns its own instance.
+ */
+    class LetterboxPreprocessor {
+    public:
+        /** @return Geometry for the given resolutions, computed on the first call. */
+        const LetterboxGeometry &geometry(
+                const cv::Size &sourceSize,
+                const cv::Size &targetSize,
+                bool autoPad,
+                int stride = 32);
+
+        /**
+         * @param image CV_8UC3 BGR image, which may be a non-continuous ROI.
+         * @param swapRB Write the planes in RGB order instead of BGR.
+         * @param outTensor Receives 3 * geometry.outputSize.area() floats.
+         */
+        void run(const cv::Mat &image, const LetterboxGeometry &geometry, bool swapRB, float *outTensor);
+
+        /** Same as run(), for the raw image data. */
+        void run(
+                const uint8_t *image,
+                size_t step,
+                const LetterboxGeometry &geometry,
+                bool swapRB,
+                float *outTensor);
+
+    private:
+        void interpolateRow(const uint8_t *sourceRow, const LetterboxGeometry &geometry, float *outRow) const;
+
+    private:
+        /** Crops come in arbitrary sizes, so the cache is cleared once it grows beyond this. */
+        static constexpr size_t kMaxCachedGeometries = 16;
+
+        std::map<std::array<int, 6>, LetterboxGeometry> m_geometries;
+
+        /** Horizontally interpolated source rows, 3 planes each, and their source row indices. */
+        std::vector<float> m_rows;
+        std::array<int, 2> m_rowIndices{-1, -1};
+    };
+
+}
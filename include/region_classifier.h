@@ -0,0 +1,34 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "detection.h"
+
+namespace nx_meta_plugin {
+
+/**
+ * Classifier of the tracked people, as seen by TrackingStage: YOLO11Classifier in the plugin, a
+ * stand-in where the model is not available.
+ */
+    class RegionClassifier {
+    public:
+        virtual ~RegionClassifier() = default;
+
+        /**
+         * @param frame CV_8UC3 BGR frame.
+         * @param regions Clipped to the frame.
+         * @param memory Resource the result is allocated from, such as the FrameArena of the frame.
+         * @return One classification per region, in the same order.
+         */
+        virtual std::pmr::vector<Classification> run(
+                const cv::Mat &frame,
+                const std::vector<cv::Rect> &regions,
+                std::pmr::memory_resource *memory) = 0;
+    };
+
+}
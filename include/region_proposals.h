@@ -0,0 +1,29 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace nx_meta_plugin {
+
+/**
+ * Turn the regions of a frame where something moves into the regions to run the detector on, so
+ * that in sparse scenes only a small part of the frame goes through the detector.
+ *
+ * Each region is padded by a quarter of its size on every side, so that the whole object is seen
+ * even if only part of it moved, grown to a minimum size which gives the detector some context,
+ * and clamped to the frame. Overlapping regions are merged.
+ *
+ * @param changedRegions Bounding boxes of the moving or tracked objects, in frame pixels.
+ * @param outRegions Receives the proposed regions.
+ * @return False if the proposals would cost about as much as the whole frame: there are too many
+ *     of them, or they cover most of the frame. outRegions is unspecified then.
+ */
+    bool proposeRegions(
+            const std::vector<cv::Rect> &changedRegions,
+            const cv::Size &frameSize,
+            std::vector<cv::Rect> *outRegions);
+
+}
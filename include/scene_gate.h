@@ -0,0 +1,107 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace nx_meta_plugin {
+
+/**
+ * Cheap test run before the detector, which tells whether a frame can have anything new to detect.
+ *
+ * Every frame is reduced to a small grayscale thumbnail, which is compared against a running
+ * average of the previous thumbnails (the background) and against the previous thumbnail. The
+ * detector can be skipped when:
+ * - the frame is black;
+ * - the stream is frozen: the thumbnail has not changed at all for kFrozenDuration;
+ * - the scene is static: few thumbnail pixels differ from the background, no track is active, and
+ *     the last refresh is less than the refresh interval ago. A refresh runs the detector on the whole
+ *     frame regardless, so that stationary objects are still found.
+ *
+ * Which parts of the frame have changed is kept for hasChangedPixels() and changedRegions(), so
+ * that the detector can be run only on them.
+ *
+ * The comparison is one vectorized pass over the thumbnail. Not thread-safe; each camera owns its
+ * own instance.
+ */
+    class SceneGate {
+    public:
+        enum class Decision {
+            detect, /**< Something changed or is tracked. */
+            refresh, /**< Periodic run on the whole frame, whether anything changed or not. */
+            skipStatic,
+            skipFrozen,
+            skipBlack,
+        };
+
+        struct Stats {
+            uint64_t checkedFrames = 0;
+            uint64_t skippedStatic = 0;
+            uint64_t skippedFrozen = 0;
+            uint64_t skippedBlack = 0;
+
+            uint64_t savedInferences() const { return skippedStatic + skippedFrozen + skippedBlack; }
+        };
+
+        static constexpr int kThumbnailWidth = 96;
+        static constexpr int kThumbnailHeight = 54;
+
+        /** Thumbnail pixels (0..255) which differ from the background by more are changed. */
+        static constexpr float kChangedPixelThreshold = 20;
+
+        /** Fraction of changed thumbnail pixels which counts as motion. */
+        static constexpr float kMotionFraction = 0.002f;
+
+        static constexpr int64_t kFrozenDurationUs = 5'000'000;
+        static constexpr int64_t kDefaultRefreshIntervalUs = 2'000'000;
+
+    public:
+        /**
+         * @param image CV_8UC3 BGR frame.
+         * @param hasActiveTracks Whether the tracker follows any object; the detector always runs
+         *     then, unless the frame is black or frozen.
+         */
+        Decision check(const cv::Mat &image, int64_t timestampUs, bool hasActiveTracks);
+
+        const Stats &stats() const { return m_stats; }
+
+        /**
+         * @return Whether the last checked frame differs from the background inside the region.
+         *     Resolution is that of the thumbnail, so the region is rounded outwards.
+         */
+        bool hasChangedPixels(const cv::Rect &region, const cv::Size &frameSize) const;
+
+        /**
+         * @return Bounding boxes, in frame pixels, of the connected groups of changed pixels of the
+         *     last checked frame. Valid until the next call.
+         */
+        const std::vector<cv::Rect> &changedRegions(const cv::Size &frameSize);
+
+        void setRefreshInterval(int64_t refreshIntervalUs) { m_refreshIntervalUs = refreshIntervalUs; }
+
+    private:
+        void makeThumbnail(const cv::Mat &image);
+
+    private:
+        std::vector<float> m_thumbnail;
+        std::vector<float> m_previousThumbnail;
+        std::vector<float> m_background;
+        std::vector<uint8_t> m_changedMask; /**< One bit per thumbnail pixel. */
+
+        // Used only by changedRegions().
+        std::vector<cv::Rect> m_changedRegions;
+        std::vector<uint8_t> m_visited;
+        std::vector<int> m_pixelStack;
+        cv::Size m_imageSize;
+
+        int64_t m_refreshIntervalUs = kDefaultRefreshIntervalUs;
+        int64_t m_lastRefreshUs = 0;
+        int64_t m_unchangedSinceUs = -1; /**< Timestamp since which the thumbnail is identical. */
+        Stats m_stats;
+    };
+
+}
@@ -0,0 +1,90 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+
+namespace nx_meta_plugin {
+
+    // Engine settings. Names must match the engineSettingsModel in the Plugin manifest.
+
+    const std::string kModelIdleTimeoutSetting = "modelIdleTimeoutS";
+    constexpr int kDefaultModelIdleTimeoutS = 60;
+
+    const std::string kPreferInt8ModelsSetting = "preferInt8Models";
+    constexpr bool kDefaultPreferInt8Models = false;
+
+    const std::string kDetectionMaxBatchSizeSetting = "detectionMaxBatchSize";
+    constexpr int kDefaultDetectionMaxBatchSize = 8;
+
+    const std::string kDetectionMaxWaitMsSetting = "detectionMaxWaitMs";
+    constexpr int kDefaultDetectionMaxWaitMs = 5;
+
+    // DeviceAgent settings. Names must match the deviceAgentSettingsModel in the Engine manifest.
+
+    const std::string kClassificationSizeBucketingSetting = "classificationSizeBucketing";
+    constexpr bool kDefaultClassificationSizeBucketing = false;
+
+    const std::string kClassificationIntervalSetting = "classificationIntervalS";
+    constexpr int kDefaultClassificationIntervalS = 2;
+
+    const std::string kTargetDetectionRateSetting = "targetDetectionRate";
+    constexpr int kDefaultTargetDetectionRate = 15;
+
+    const std::string kSkipUnchangedFramesSetting = "skipUnchangedFrames";
+    constexpr bool kDefaultSkipUnchangedFrames = true;
+
+    const std::string kFrameDropPolicySetting = "frameDropPolicy";
+    const std::string kDropOldestFramePolicy = "dropOldest";
+    const std::string kDropNewestFramePolicy = "dropNewest";
+    const std::string kDefaultFrameDropPolicy = kDropOldestFramePolicy;
+
+    const std::string kDetectionTilesSetting = "detectionTiles";
+    const std::string kDefaultDetectionTiles = "1x1";
+
+    const std::string kTileOverlapPercentSetting = "tileOverlapPercent";
+    constexpr int kDefaultTileOverlapPercent = 20;
+
+    const std::string kDetectMotionRegionsOnlySetting = "detectMotionRegionsOnly";
+    constexpr bool kDefaultDetectMotionRegionsOnly = false;
+
+    const std::string kFullFrameDetectionIntervalSetting = "fullFrameDetectionIntervalS";
+    constexpr int kDefaultFullFrameDetectionIntervalS = 2;
+
+    const std::string kDetectionKeyframeIntervalSetting = "detectionKeyframeInterval";
+    constexpr int kDefaultDetectionKeyframeInterval = 1;
+
+    const std::string kTrackerSetting = "tracker";
+    const std::string kTbmTracker = "tbm";
+    const std::string kByteTrackTracker = "byteTrack";
+    const std::string kDefaultTracker = kTbmTracker;
+
+/**
+ * Parse an integer setting value received from the Server. Values that cannot be parsed yield
+ * defaultValue; the result is clamped to [minValue, maxValue].
+ */
+    inline int parseIntSetting(const std::string &value, int defaultValue, int minValue, int maxValue) {
+        int result = defaultValue;
+        try {
+            if (!value.empty())
+                result = std::stoi(value);
+        }
+        catch (const std::exception & /*e*/) {
+        }
+        return std::max(minValue, std::min(result, maxValue));
+    }
+
+/**
+ * Parse a boolean setting value received from the Server. The Server sends CheckBox values as
+ * "true" or "false"; anything else yields defaultValue.
+ */
+    inline bool parseBoolSetting(const std::string &value, bool defaultValue) {
+        if (value == "true")
+            return true;
+        if (value == "false")
+            return false;
+        return defaultValue;
+    }
+
+}
@@ -0,0 +1,31 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+/**
+ * Selects the SIMD instruction set used by the vectorized kernels of the plugin. The choice is made
+ * at compile time from the flags the plugin is built with (see the `useAvx2` CMake option), and
+ * every kernel keeps a scalar fallback for other targets.
+ */
+
+#if defined(__AVX2__)
+    #define NX_PLUGIN_SIMD_AVX2
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define NX_PLUGIN_SIMD_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace nx_meta_plugin {
+
+    /** Name of the instruction set the kernels were compiled for, for logging. */
+    constexpr const char *kSimdInstructionSet =
+#if defined(NX_PLUGIN_SIMD_AVX2)
+            "AVX2";
+#elif defined(NX_PLUGIN_SIMD_SSE2)
+            "SSE2";
+#else
+            "scalar";
+#endif
+
+}
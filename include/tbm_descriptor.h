@@ -0,0 +1,93 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/tracking/tracking_by_matching.hpp>
+
+namespace nx_meta_plugin {
+
+/**
+ * Fast appearance descriptor of cv::tbm: the box bilinearly sampled to 16x32 BGR uint8 pixels,
+ * like cv::tbm::ResizedImageDescriptor with INTER_LINEAR, but reading only the 4 frame pixels
+ * around each sample instead of resizing the whole crop.
+ *
+ * cv::tbm computes the descriptors of the detections it keeps one by one, from copies of their
+ * crops. prepare() computes them beforehand from the frame itself, and compute() then hands them
+ * out in the same order. The descriptor of a stationary object, whose box has not moved since the
+ * previous frame and matches no other box, is reused for up to kMaxReuseFrames frames instead of
+ * being sampled again.
+ *
+ * Not thread-safe; each tracker owns its own instance.
+ */
+    class SampledImageDescriptor : public cv::tbm::IImageDescriptor {
+    public:
+        static constexpr int kWidth = 16;
+        static constexpr int kHeight = 32;
+
+        /** Box edges may move this far (in pixels) for the object to count as stationary. */
+        static constexpr int kStationaryTolerance = 1;
+
+        /** Frames a descriptor is reused for at most, so that appearance changes are noticed. */
+        static constexpr int kMaxReuseFrames = 15;
+
+        struct Stats {
+            size_t sampled = 0;
+            size_t reused = 0;
+        };
+
+    public:
+        virtual cv::Size size() const override;
+
+        /** @param mat CV_8UC3 crop of the box. */
+        virtual void compute(const cv::Mat &mat, cv::Mat &descriptor) override;
+
+        virtual void compute(const std::vector<cv::Mat> &mats, std::vector<cv::Mat> &descriptors) override;
+
+        /**
+         * Compute the descriptors of the detections which cv::tbm keeps with these parameters, for
+         * the next process() call.
+         *
+         * @param frame CV_8UC3 BGR frame.
+         */
+        void prepare(
+                const cv::Mat &frame,
+                const cv::tbm::TrackedObjects &detections,
+                const cv::tbm::TrackerParams &params);
+
+        const Stats &stats() const { return m_stats; }
+
+    private:
+        struct PreparedDescriptor {
+            cv::Rect box; /**< Of the detection. */
+            cv::Rect sampledBox; /**< The descriptor was sampled from; older when reused. */
+            cv::Mat descriptor;
+            int reuseCount = 0;
+        };
+
+    private:
+        std::vector<PreparedDescriptor> m_prepared;
+        std::vector<PreparedDescriptor> m_previous;
+        std::vector<int> m_previousMatchCounts; /**< Detections each previous box may be reused for. */
+        size_t m_nextPrepared = 0;
+        Stats m_stats;
+    };
+
+/**
+ * Fast descriptor distance of cv::tbm: 1 minus the normalized cross-correlation of the uint8
+ * descriptors, the same value as cv::tbm::MatchTemplateDistance with TM_CCORR_NORMED, computed in
+ * one vectorized integer pass instead of through cv::matchTemplate().
+ */
+    class CrossCorrelationDistance : public cv::tbm::IDescriptorDistance {
+    public:
+        virtual float compute(const cv::Mat &descriptor1, const cv::Mat &descriptor2) override;
+
+        virtual std::vector<float> compute(
+                const std::vector<cv::Mat> &descriptors1,
+                const std::vector<cv::Mat> &descriptors2) override;
+    };
+
+}
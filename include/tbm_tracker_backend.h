@@ -0,0 +1,43 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <opencv2/tracking/tracking_by_matching.hpp>
+
+#include "tbm_descriptor.h"
+#include "tracker_backend.h"
+
+namespace nx_meta_plugin {
+
+/**
+ * Tracker backend on cv::tbm::ITrackerByMatching, which matches detections to tracks by their
+ * appearance as well as by their motion.
+ */
+    class TbmTrackerBackend : public TrackerBackend {
+    public:
+        TbmTrackerBackend();
+
+        virtual cv::tbm::TrackedObjects process(
+                const cv::Mat &frame,
+                const cv::tbm::TrackedObjects &detections,
+                int64_t timestampUs) override;
+
+        virtual void setForgetDelay(size_t frameCount) override;
+
+        virtual bool hasActiveTracks() const override;
+
+        virtual void trackMotions(std::vector<TrackMotion> *outTrackMotions) const override;
+
+    private:
+        void dropForgottenTracks();
+
+    private:
+        const std::shared_ptr<SampledImageDescriptor> m_descriptor; /**< Shared with m_tracker. */
+        const cv::Ptr<cv::tbm::ITrackerByMatching> m_tracker;
+        std::vector<size_t> m_forgottenTrackIds;
+    };
+
+}
@@ -0,0 +1,37 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace nx_meta_plugin {
+
+/**
+ * Split of a frame into a grid of overlapping tiles, each letterboxed into the detector input on
+ * its own, so that distant people in high-resolution frames keep enough pixels to be detected.
+ */
+    struct TileLayout {
+        int columns = 1;
+        int rows = 1;
+        float overlap = 0.2f; /**< Minimum overlap of neighbouring tiles, as a fraction of a tile. */
+
+        bool isTiled() const { return columns > 1 || rows > 1; }
+
+        /**
+         * @param value "<columns>x<rows>", e.g. "3x2". Values that cannot be parsed yield a single
+         *     tile.
+         */
+        static TileLayout fromString(const std::string &value, float overlap);
+    };
+
+/**
+ * @return Tiles of equal size covering the frame, in row-major order. Neighbouring tiles overlap
+ *     by at least layout.overlap of a tile, so objects cut by the border of one tile are seen
+ *     whole by its neighbour, as long as they are smaller than the overlap.
+ */
+    std::vector<cv::Rect> makeTiles(const cv::Size &frameSize, const TileLayout &layout);
+
+}
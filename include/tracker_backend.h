@@ -0,0 +1,74 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/tracking/tracking_by_matching.hpp>
+
+namespace nx_meta_plugin {
+
+/**
+ * Where a tracked object was last seen and how fast it was moving, so that its position in the
+ * following frames can be predicted.
+ */
+    struct TrackMotion {
+        cv::Rect box; /**< In frame pixels. */
+        cv::Point2f velocity; /**< In pixels per second. */
+        int64_t timestampUs = 0;
+
+        /**
+         * @return The box moved along the velocity to the given time. The prediction stops
+         *     kMaxPredictionTime after the box was seen, as the motion is not linear for long.
+         */
+        cv::Rect predict(int64_t timestampUs) const;
+
+        static constexpr int64_t kMaxPredictionTimeUs = 1'000'000;
+    };
+
+    enum class TrackerType {
+        tbm, /**< cv::tbm tracking by matching: motion and appearance. */
+        byteTrack, /**< ByteTracker: motion only; much cheaper in crowds. */
+    };
+
+/**
+ * Associates the detections of consecutive frames into tracks; the algorithm behind
+ * ObjectTracker. Detections and tracked objects are cv::tbm::TrackedObject in frame pixels, the
+ * format the plugin converts its detections to, with object_id holding the id of the track.
+ *
+ * Not thread-safe.
+ */
+    class TrackerBackend {
+    public:
+        virtual ~TrackerBackend() = default;
+
+        /**
+         * @param detections Detections of the frame; object_id is ignored.
+         * @return The detections which belong to a track after this frame, with their rects and
+         *     frame_idx unchanged and object_id set. Track ids are never reused.
+         */
+        virtual cv::tbm::TrackedObjects process(
+                const cv::Mat &frame,
+                const cv::tbm::TrackedObjects &detections,
+                int64_t timestampUs) = 0;
+
+        /** Tracks not matched for this many processed frames are forgotten. */
+        virtual void setForgetDelay(size_t frameCount) = 0;
+
+        /** @return Whether any track is still followed, i.e. has not been forgotten yet. */
+        virtual bool hasActiveTracks() const = 0;
+
+        /**
+         * @param outTrackMotions Motion of every track which is still followed; cleared first, so
+         *     that the caller can reuse it from frame to frame.
+         */
+        virtual void trackMotions(std::vector<TrackMotion> *outTrackMotions) const = 0;
+    };
+
+    std::unique_ptr<TrackerBackend> createTrackerBackend(TrackerType type);
+
+}
@@ -0,0 +1,91 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <nx/sdk/analytics/helpers/object_metadata_packet.h>
+#include <nx/sdk/ptr.h>
+
+#include "classification_cache.h"
+#include "frame.h"
+#include "frame_memory.h"
+#include "object_metadata_builder.h"
+#include "object_tracker.h"
+#include "region_classifier.h"
+
+namespace nx_meta_plugin {
+
+/**
+ * Second stage of the pipeline of a DeviceAgent: tracks the detected objects of a frame, labels
+ * the people through the classification cache and the classifier, and builds the metadata packet.
+ * Also publishes the motion of the tracks, for the detection stage to know where to look.
+ *
+ * run() and the setters are called only by the tracking thread; trackMotions() and
+ * hasActiveTracks() by any thread.
+ */
+    class TrackingStage {
+    public:
+        /** @param classifier Not owned; must outlive the stage. */
+        explicit TrackingStage(RegionClassifier *classifier, TrackerType trackerType = TrackerType::tbm);
+
+        /** Takes effect on the next run(); the tracks are lost when the type changes. */
+        void setTrackerType(TrackerType type) { m_trackerType = type; }
+
+        /** @param intervalUs 0 to classify every tracked person on every frame. */
+        void setClassificationInterval(int64_t intervalUs);
+
+        void setDetectionRate(double rateHz) { m_detectionRateHz = rateHz; }
+
+        /**
+         * Track, classify and convert to metadata the detections of the frame. The tracked
+         * detections are put into memory->trackedDetections.
+         *
+         * @return Null if no object is tracked on the frame.
+         */
+        nx::sdk::Ptr<nx::sdk::analytics::ObjectMetadataPacket> run(const Frame &frame, FrameMemory *memory);
+
+        /**
+         * @param outTrackMotions Motion of every track after the last run(); cleared first, so that
+         *     the caller can reuse it from frame to frame.
+         */
+        void trackMotions(std::vector<TrackMotion> *outTrackMotions) const;
+
+        /** @return Whether any track was still followed after the last run(). */
+        bool hasActiveTracks() const { return m_hasActiveTracks; }
+
+    private:
+        void resetTracksOnChanges(const Frame &frame);
+
+        void classify(const Frame &frame, FrameMemory *memory);
+
+    private:
+        /** Classification cache counters are printed every kClassificationReportPeriod frames. */
+        static constexpr uint64_t kClassificationReportPeriod = 1000;
+
+    private:
+        RegionClassifier *const m_classifier;
+        std::unique_ptr<ObjectTracker> m_objectTracker;
+        TrackerType m_trackerType;
+        double m_detectionRateHz = 0;
+        int m_frameWidth = 0; /**< Of the frames tracked so far; 0 before the first one. */
+        int m_frameHeight = 0;
+
+        // Labels of the tracks, so that people are not classified on every frame.
+        ClassificationCache m_classificationCache;
+        std::vector<size_t> m_classifiedDetections;
+        std::vector<cv::Rect> m_classifiedRegions;
+        uint64_t m_classifiedFrameCount = 0;
+
+        ObjectMetadataBuilder m_objectMetadataBuilder;
+
+        std::atomic<bool> m_hasActiveTracks{false};
+        mutable std::mutex m_trackMotionsMutex;
+        std::vector<TrackMotion> m_trackMotions;
+    };
+
+}
@@ -5,22 +5,21 @@
 #include <opencv2/opencv.hpp>
 
 #include <nx/kit/debug.h>
-#include <nx/sdk/analytics/rect.h>
 #include "detection.h"
 #include "frame.h"
 #include "geometry.h"
 
 namespace nx_meta_plugin {
-    inline void drawBoundingBox(const cv::Mat &image, std::shared_ptr<Detection> &detection) {
+    inline void drawBoundingBox(const cv::Mat &image, const DetectionBatch &detections, size_t index) {
         // Draw the bounding box rectangle
-        cv::Size frameSize = image.size();
-        const cv::Rect boundingBox = nxRectToCvRect(detection->boundingBox, frameSize.width, frameSize.height);
+        const cv::Rect &boundingBox = detections.boxes[index];
         cv::rectangle(image, cv::Point(boundingBox.x, boundingBox.y),
                       cv::Point(boundingBox.x + boundingBox.width,
                                 boundingBox.y + boundingBox.height),
                       cv::Scalar(0, 0, 0), 2, cv::LINE_AA);
 
         // Prepare label text with class name and confidence percentage
+        const std::string label = classificationLabel(detections.labels[index]);
 
         // Define text properties for labels
         int fontFace = cv::FONT_HERSHEY_SIMPLEX;
@@ -29,18 +28,18 @@ namespace nx_meta_plugin {
         int baseline = 0;
 
         // Calculate text size for background rectangles
-        cv::Size textSize = cv::getTextSize(detection->classLabel, fontFace, fontScale, thickness, &baseline);
+        cv::Size textSize = cv::getTextSize(label, fontFace, fontScale, thickness, &baseline);
 
         // Define positions for the label
-        int labelY = std::max(static_cast<int>(detection->boundingBox.y), textSize.height + 5);
-        cv::Point labelTopLeft(detection->boundingBox.x, labelY - textSize.height - 5);
-        cv::Point labelBottomRight(detection->boundingBox.x + textSize.width + 5, labelY + baseline - 5);
+        int labelY = std::max(boundingBox.y, textSize.height + 5);
+        cv::Point labelTopLeft(boundingBox.x, labelY - textSize.height - 5);
+        cv::Point labelBottomRight(boundingBox.x + textSize.width + 5, labelY + baseline - 5);
 
         // Draw background rectangle for label
         cv::rectangle(image, labelTopLeft, labelBottomRight, cv::Scalar(0, 0, 0), cv::FILLED);
 
         // Put label text
-        cv::putText(image, detection->classLabel, cv::Point(detection->boundingBox.x + 2, labelY - 2), fontFace,
+        cv::putText(image, label, cv::Point(boundingBox.x + 2, labelY - 2), fontFace,
                     fontScale,
                     cv::Scalar(255, 255, 255), thickness, cv::LINE_AA);
     }
@@ -1,31 +1,31 @@
 #pragma once
 
-#include <onnxruntime_cxx_api.h>
-#include <opencv2/opencv.hpp>
-
-#include <algorithm>
-#include <fstream>
-#include <iostream>
-#include <numeric>
-#include <string>
-#include <vector>
-#include <memory>
-#include <chrono>
-#include <random>
-#include <unordered_map>
-#include <thread>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
-#include <string>
+#include <memory_resource>
 #include <vector>
 
+#include <opencv2/core/core.hpp>
+
+#include "bound_session.h"
 #include "detection.h"
 #include "geometry.h"
+#include "model_registry.h"
+#include "nms.h"
+#include "preprocessing.h"
+#include "region_classifier.h"
+#include "yolo_decoder.h"
 
 namespace nx_meta_plugin {
-    class YOLO11Classifier {
+    class YOLO11Classifier : public RegionClassifier {
     public:
-        explicit YOLO11Classifier(std::filesystem::path modelDir);
+        YOLO11Classifier(
+                std::filesystem::path modelDir,
+                std::shared_ptr<ModelRegistry> modelRegistry,
+                const ModelOptions &modelOptions);
 
         void ensureInitialized();
 
@@ -33,38 +33,85 @@ namespace nx_meta_plugin {
 
         void terminate();
 
-        std::string run(const cv::Mat &frame);
+        /**
+         * Classify the regions of the frame with as few inference calls as possible: regions are
+         * grouped by the input size they are letterboxed to, and every group is run as one batch.
+         * Each region is read straight from the frame into the input tensor, never copied.
+         *
+         * @param frame CV_8UC3 BGR frame.
+         * @param regions Clipped to the frame.
+         * @param memory Resource the result is allocated from, such as the FrameArena of the frame.
+         * @return One classification per region, in the same order. Empty regions are
+         *     classified as kUnknownClassification.
+         */
+        virtual std::pmr::vector<Classification> run(
+                const cv::Mat &frame,
+                const std::vector<cv::Rect> &regions,
+                std::pmr::memory_resource *memory) override;
+
+        /**
+         * Letterbox every region into the smallest of kSizeBuckets it fits into, instead of the
+         * default input size. Has effect only for models with dynamic input height and width.
+         */
+        void setSizeBucketing(bool enabled);
 
     private:
         void loadModel();
 
-        std::string runImpl(const cv::Mat &frame);
+        std::pmr::vector<Classification> runImpl(
+                const cv::Mat &frame,
+                const std::vector<cv::Rect> &regions,
+                std::pmr::memory_resource *memory);
+
+        cv::Size inputSizeFor(const cv::Size &regionSize) const;
 
-        cv::Mat preprocess(const cv::Mat &image, float *&blob, std::vector<int64_t> &inputTensorShape);
+        void classifyBatch(
+                const cv::Mat &frame,
+                const std::vector<size_t> &regionIndices,
+                const cv::Size &inputSize,
+                std::pmr::vector<Classification> *outClassifications);
 
-        std::string
+        void preprocess(const cv::Mat &frame, const cv::Rect &region, const cv::Size &inputSize, float *blob);
+
+        Classification
         postprocess(const cv::Size &originalImageSize, const cv::Size &resizedImageShape,
-                    const std::vector<Ort::Value> &outputTensors, float confThreshold = 0.25f,
-                    float iouThreshold = 0.45f);
+                    const float *rawOutput, const std::vector<int64_t> &outputShape,
+                    float confThreshold = 0.25f, float iouThreshold = 0.45f);
+
+    private:
+        /**
+         * Pixels of all the inputs of one batch at most: the bound input buffer of every
+         * DeviceAgent takes 12 bytes per pixel (3 float channels), so it stays under 10 MB
+         * whatever the input size. A batch of 640x640 inputs holds 2 regions, and of 128x128 ones
+         * kMaxBatchSize.
+         */
+        static constexpr size_t kMaxBatchPixels = 2 * 640 * 640;
+
+        /** Regions in one batch at most, whatever their input size. */
+        static constexpr size_t kMaxBatchSize = 16;
+
+        /** Input size of models with dynamic height and width when size bucketing is off. */
+        static constexpr int kDefaultInputSize = 640;
+
+        static constexpr int kSizeBuckets[] = {128, 256, 384, 512, 640};
 
     private:
         bool m_netLoaded = false;
         bool m_terminated = false;
         bool useGPU = false;
         std::filesystem::path m_modelDir;
-
-        Ort::Env env{nullptr};                         // ONNX Runtime environment
-        Ort::SessionOptions sessionOptions{nullptr};   // Session options for ONNX Runtime
-        Ort::Session session{nullptr};                 // ONNX Runtime session for running inference
-        bool isDynamicInputShape{};                    // Flag indicating if input shape is dynamic
-        cv::Size inputImageShape;                      // Expected input image shape for the model
-
-        // Vectors to hold allocated input and output node names
-        std::vector<Ort::AllocatedStringPtr> inputNodeNameAllocatedStrings;
-        std::vector<const char *> inputNames;
-        std::vector<Ort::AllocatedStringPtr> outputNodeNameAllocatedStrings;
-        std::vector<const char *> outputNames;
-
-        size_t numInputNodes, numOutputNodes;          // Number of input and output nodes in the model
+        const ModelOptions m_modelOptions;
+
+        const std::shared_ptr<ModelRegistry> m_modelRegistry;
+        std::shared_ptr<ModelSession> m_session; /**< Shared with other DeviceAgents via the registry. */
+        std::unique_ptr<BoundSession> m_boundSession; /**< Declared after m_session to be destroyed first. */
+        std::atomic<bool> m_sizeBucketing{false}; /**< Set from the Server thread. */
+
+        LetterboxPreprocessor m_preprocessor;
+        YoloDecoder m_decoder;
+        NmsBoxes m_nmsBoxes;
+        NmsEngine m_nms{{/*topK*/ 300, /*maxDetections*/ 1}}; /**< Only the best box is used. */
+        std::vector<cv::Rect> m_regions; /**< Clipped to the frame. */
+        std::vector<size_t> m_batchRegionIndices;
     };
 }
@@ -22,14 +22,24 @@
 #include <nx/sdk/helpers/uuid_helper.h>
 #include <nx/sdk/uuid.h>
 
+#include "bound_session.h"
 #include "detection.h"
 #include "frame.h"
 #include "geometry.h"
+#include "inference_scheduler.h"
+#include "model_registry.h"
+#include "nms.h"
+#include "preprocessing.h"
+#include "yolo_decoder.h"
 
 namespace nx_meta_plugin {
     class YOLO11Detector {
     public:
-        explicit YOLO11Detector(std::filesystem::path modelDir);
+        YOLO11Detector(
+                std::filesystem::path modelDir,
+                std::shared_ptr<ModelRegistry> modelRegistry,
+                std::shared_ptr<InferenceScheduler> inferenceScheduler,
+                const ModelOptions &modelOptions);
 
         void ensureInitialized();
 
@@ -37,38 +47,60 @@ namespace nx_meta_plugin {
 
         void terminate();
 
-        DetectionList run(const cv::Mat &frame);
+        /**
+         * @param regions Parts of the frame to detect on, such as tiles or motion regions, each
+         *     letterboxed into the model input on its own and run as one batch, with the
+         *     detections merged across the region borders by NMS. If empty, the whole frame is
+         *     letterboxed into the model input.
+         * @param outDetections Cleared first; its memory resource is kept.
+         */
+        void run(const cv::Mat &frame, const std::vector<cv::Rect> &regions, DetectionBatch *outDetections);
 
     private:
         void loadModel();
 
-        DetectionList runImpl(const cv::Mat &frame);
+        void runImpl(const cv::Mat &frame, const std::vector<cv::Rect> &regions, DetectionBatch *outDetections);
 
-        cv::Mat preprocess(const cv::Mat &image, float *&blob, std::vector<int64_t> &inputTensorShape);
+        cv::Size regionInputSize(const std::vector<cv::Rect> &regions) const;
 
-        DetectionList
-        postprocess(const cv::Size &originalImageSize, const cv::Size &resizedImageShape,
-                    const std::vector<Ort::Value> &outputTensors, float confThreshold = 0.4f,
-                    float iouThreshold = 0.45f);
+        void detectRegions(const cv::Mat &frame, const std::vector<cv::Rect> &regions);
+
+        const LetterboxGeometry &inputGeometry(const cv::Mat &image, std::vector<int64_t> &inputTensorShape);
+
+        void preprocess(const cv::Mat &image, std::vector<int64_t> &inputTensorShape);
+
+        void appendCandidates(const cv::Rect &region, const cv::Size &resizedImageShape,
+                              const float *rawOutput, const std::vector<int64_t> &outputShape,
+                              float confThreshold = 0.4f);
+
+        void postprocess(DetectionBatch *outDetections, float iouThreshold = 0.45f);
+
+    private:
+        /**
+         * Pixels of all the regions of one batch at most, as for YOLO11Classifier: the bound input
+         * keeps the size of the largest batch, 12 bytes per pixel, so it stays under 10 MB. A batch
+         * of 640x640 regions holds 2 of them.
+         */
+        static constexpr size_t kMaxBatchPixels = 2 * 640 * 640;
+
+        /** Regions in one batch at most, whatever their input size. */
+        static constexpr size_t kMaxBatchSize = 16;
 
     private:
         bool m_netLoaded = false;
         bool m_terminated = false;
         bool useGPU = false;
         std::filesystem::path m_modelDir;
+        const ModelOptions m_modelOptions;
 
-        Ort::Env env{nullptr};                         // ONNX Runtime environment
-        Ort::SessionOptions sessionOptions{nullptr};   // Session options for ONNX Runtime
-        Ort::Session session{nullptr};                 // ONNX Runtime session for running inference
-        bool isDynamicInputShape{};                    // Flag indicating if input shape is dynamic
-        cv::Size inputImageShape;                      // Expected input image shape for the model
-
-        // Vectors to hold allocated input and output node names
-        std::vector<Ort::AllocatedStringPtr> inputNodeNameAllocatedStrings;
-        std::vector<const char *> inputNames;
-        std::vector<Ort::AllocatedStringPtr> outputNodeNameAllocatedStrings;
-        std::vector<const char *> outputNames;
+        const std::shared_ptr<ModelRegistry> m_modelRegistry;
+        std::shared_ptr<ModelSession> m_session; /**< Shared with other DeviceAgents via the registry. */
+        std::unique_ptr<BoundSession> m_boundSession; /**< Declared after m_session to be destroyed first. */
+        const std::shared_ptr<InferenceScheduler> m_inferenceScheduler;
 
-        size_t numInputNodes, numOutputNodes;          // Number of input and output nodes in the model
+        LetterboxPreprocessor m_preprocessor;
+        YoloDecoder m_decoder{kClassesToDetect}; /**< Scans only the classes the plugin reports. */
+        NmsBoxes m_nmsBoxes; /**< Candidates of all the images of the frame, in frame coordinates. */
+        NmsEngine m_nms;
     };
 }
@@ -0,0 +1,57 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "class_mask.h"
+
+namespace nx_meta_plugin {
+
+    /** Anchor of a YOLO output whose best class score exceeds the confidence threshold. */
+    struct YoloCandidate {
+        int32_t anchor = 0;
+        int32_t classId = 0;
+        float score = 0;
+    };
+
+/**
+ * Finds the best class of every anchor of a YOLO output in the channel-major layout ONNX Runtime
+ * returns ([4 + classes, anchors]: the box rows followed by one row of scores per class).
+ *
+ * Instead of walking the class column of each anchor with a stride of the anchor count, the class
+ * rows are streamed one after another, keeping a running max and argmax for all anchors with SIMD
+ * compare and blend. Anchors below the threshold are dropped before any box math is done by the
+ * caller. Not thread-safe; each detector or classifier owns its own instance.
+ *
+ * The decoder is specialized for a set of classes when constructed: only the rows of those classes
+ * are read, so other classes never become candidates and never reach NMS. With a single class the
+ * row is thresholded directly, without the max/argmax pass.
+ */
+    class YoloDecoder {
+    public:
+        explicit YoloDecoder(const ClassMask &classes = ClassMask::all());
+
+        /**
+         * @param classScores Points to the first class row, i.e. to row 4 of the output.
+         * @return Anchors whose best score among the decoder classes is greater than confThreshold,
+         *     in anchor order. Ties between classes are resolved to the lower class id. Valid until
+         *     the next call.
+         */
+        const std::vector<YoloCandidate> &findCandidates(
+                const float *classScores,
+                size_t numAnchors,
+                int numClasses,
+                float confThreshold);
+
+    private:
+        const ClassMask m_classes;
+        std::vector<int32_t> m_classRows; /**< Decoder classes present in the last output. */
+        std::vector<float> m_maxScores;
+        std::vector<int32_t> m_classIds;
+        std::vector<YoloCandidate> m_candidates;
+    };
+
+}
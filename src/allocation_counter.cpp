@@ -0,0 +1,148 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace nx_meta_plugin {
+
+    static std::atomic<uint64_t> allocationCounters[kAllocationStageCount];
+    static thread_local AllocationStage currentStage = AllocationStage::other;
+
+    const char *allocationStageName(AllocationStage stage) {
+        switch (stage) {
+            case AllocationStage::other: return "other";
+            case AllocationStage::detection: return "detection";
+            case AllocationStage::tracking: return "tracking";
+            case AllocationStage::classification: return "classification";
+            case AllocationStage::metadata: return "metadata";
+        }
+        return "unknown";
+    }
+
+    AllocationCounts allocationCounts() {
+        AllocationCounts result{};
+        for (size_t i = 0; i < kAllocationStageCount; ++i)
+            result[i] = allocationCounters[i].load(std::memory_order_relaxed);
+        return result;
+    }
+
+    AllocationScope::AllocationScope(AllocationStage stage) :
+            m_previousStage(currentStage) {
+        currentStage = stage;
+    }
+
+    AllocationScope::~AllocationScope() {
+        currentStage = m_previousStage;
+    }
+
+    void AllocationMonitor::start() {
+        m_startCounts = allocationCounts();
+        m_frames = 0;
+    }
+
+    double AllocationMonitor::allocationsPerFrame(AllocationStage stage) const {
+        if (m_frames == 0)
+            return 0;
+        const size_t i = (size_t) stage;
+        return (double) (allocationCounts()[i] - m_startCounts[i]) / (double) m_frames;
+    }
+
+    bool AllocationMonitor::isWithin(const AllocationCounts &budget) const {
+        const AllocationCounts counts = allocationCounts();
+        for (size_t i = (size_t) AllocationStage::other + 1; i < kAllocationStageCount; ++i) {
+            if ((double) (counts[i] - m_startCounts[i]) > (double) budget[i] * (double) m_frames)
+                return false;
+        }
+        return true;
+    }
+
+}
+
+#if defined(NX_PLUGIN_COUNT_ALLOCATIONS)
+
+// Replacements of the global allocation functions. The plugin is linked with -Bsymbolic in this
+// build, so that its own code (and the libraries linked into it statically) binds to them rather
+// than to the ones of the C++ runtime already loaded into the Server process.
+
+static void countAllocation() {
+    using namespace nx_meta_plugin;
+    allocationCounters[(size_t) currentStage].fetch_add(1, std::memory_order_relaxed);
+}
+
+static void *allocate(size_t size) {
+    countAllocation();
+    return std::malloc(size > 0 ? size : 1);
+}
+
+static void *allocateAligned(size_t size, std::align_val_t alignment) {
+    countAllocation();
+    const size_t alignmentBytes = (size_t) alignment;
+#if defined(_WIN32)
+    return _aligned_malloc(size > 0 ? size : 1, alignmentBytes);
+#else
+    // aligned_alloc() takes only sizes which are multiples of the alignment.
+    const size_t roundedSize = ((size > 0 ? size : 1) + alignmentBytes - 1) / alignmentBytes * alignmentBytes;
+    return std::aligned_alloc(alignmentBytes, roundedSize);
+#endif
+}
+
+static void deallocateAligned(void *p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void *operator new(size_t size) {
+    if (void *const p = allocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+    if (void *const p = allocateAligned(size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+    return ::operator new(size, alignment);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+
+void operator delete(void *p, std::align_val_t) noexcept { deallocateAligned(p); }
+
+void operator delete[](void *p, std::align_val_t) noexcept { deallocateAligned(p); }
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept { deallocateAligned(p); }
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { deallocateAligned(p); }
+
+#endif
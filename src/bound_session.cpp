@@ -0,0 +1,81 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "bound_session.h"
+
+#include <algorithm>
+
+#include "geometry.h"
+
+namespace nx_meta_plugin {
+
+    BoundSession::BoundSession(ModelSession *session) :
+            m_session(session),
+            m_binding(session->session),
+            m_memoryInfo(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)) {
+    }
+
+    float *BoundSession::input(const std::vector<int64_t> &inputShape) {
+        if (inputShape == m_inputShape)
+            return m_input.data();
+
+        // Growing the buffer moves it, and the shape is part of the bound value, so rebind both the
+        // input and the output whenever the shape changes.
+        m_inputShape = inputShape;
+        const size_t inputSize = vectorProduct(inputShape);
+        if (m_input.size() < inputSize)
+            m_input.resize(inputSize);
+
+        const Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
+                m_memoryInfo, m_input.data(), inputSize, m_inputShape.data(), m_inputShape.size());
+        m_binding.BindInput(m_session->inputNames[0], inputTensor);
+
+        bindOutput();
+        return m_input.data();
+    }
+
+    void BoundSession::run() {
+        m_session->session.Run(Ort::RunOptions{nullptr}, m_binding);
+        if (m_isOutputBound)
+            return;
+
+        // First run with this input shape: ONNX Runtime has allocated the output, so remember its
+        // shape, move the data to the buffer and write straight into the buffer from now on.
+        const std::vector<Ort::Value> outputTensors = m_binding.GetOutputValues();
+        const float *rawOutput = outputTensors[0].GetTensorData<float>();
+        m_outputShape = outputTensors[0].GetTensorTypeAndShapeInfo().GetShape();
+        m_outputShapes[m_inputShape] = m_outputShape;
+
+        const size_t outputSize = vectorProduct(m_outputShape);
+        if (m_output.size() < outputSize)
+            m_output.resize(outputSize);
+        std::copy(rawOutput, rawOutput + outputSize, m_output.begin());
+
+        bindOutput();
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+    void BoundSession::bindOutput() {
+        m_binding.ClearBoundOutputs();
+
+        const auto it = m_outputShapes.find(m_inputShape);
+        if (it == m_outputShapes.end()) {
+            // The output shape is not known yet, let ONNX Runtime allocate the output once.
+            m_binding.BindOutput(m_session->outputNames[0], m_memoryInfo);
+            m_isOutputBound = false;
+            return;
+        }
+
+        m_outputShape = it->second;
+        const size_t outputSize = vectorProduct(m_outputShape);
+        if (m_output.size() < outputSize)
+            m_output.resize(outputSize);
+
+        const Ort::Value outputTensor = Ort::Value::CreateTensor<float>(
+                m_memoryInfo, m_output.data(), outputSize, m_outputShape.data(), m_outputShape.size());
+        m_binding.BindOutput(m_session->outputNames[0], outputTensor);
+        m_isOutputBound = true;
+    }
+
+}
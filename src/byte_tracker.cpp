@@ -0,0 +1,260 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "byte_tracker.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace nx_meta_plugin {
+
+    using namespace cv::tbm;
+
+    // Standard deviations of the noise of the Kalman filters, relative to the size of the box, as
+    // in BoT-SORT.
+    static constexpr float kPositionNoise = 1.0f / 20;
+    static constexpr float kVelocityNoise = 1.0f / 160;
+
+    /** Weight of a new interval in the average interval between the processed frames. */
+    static constexpr double kFrameIntervalUpdateRate = 0.1;
+
+    static float square(float value) {
+        return value * value;
+    }
+
+    TrackedObjects ByteTracker::process(
+            const cv::Mat & /*frame*/,
+            const TrackedObjects &detections,
+            int64_t timestampUs) {
+        if (m_lastTimestampUs >= 0 && timestampUs > m_lastTimestampUs) {
+            const double intervalUs = (double) (timestampUs - m_lastTimestampUs);
+            m_frameIntervalUs = m_frameIntervalUs == 0
+                                ? intervalUs
+                                : m_frameIntervalUs + kFrameIntervalUpdateRate * (intervalUs - m_frameIntervalUs);
+        }
+        m_lastTimestampUs = timestampUs;
+
+        predict();
+
+        m_trackDetections.assign(m_ids.size(), -1);
+        m_detectionTracks.assign(detections.size(), -1);
+        associate(detections, kHighScore, std::numeric_limits<float>::max(), /*onlyMatchedTracks*/ false,
+                  kMinHighScoreIou);
+        associate(detections, kLowScore, kHighScore, /*onlyMatchedTracks*/ true, kMinLowScoreIou);
+
+        TrackedObjects result;
+        for (size_t track = 0; track < m_ids.size(); ++track) {
+            const int32_t detection = m_trackDetections[track];
+            if (detection < 0) {
+                ++m_lostFrames[track];
+                continue;
+            }
+
+            const TrackedObject &object = detections[(size_t) detection];
+            update(track, object.rect);
+            m_lostFrames[track] = 0;
+            m_lastBoxes[track] = object.rect;
+            m_lastSeenUs[track] = timestampUs;
+
+            result.push_back(object);
+            result.back().object_id = (int) m_ids[track];
+            result.back().timestamp = (uint64_t) timestampUs;
+        }
+
+        // Backwards, as a removed track is replaced by the last one.
+        for (size_t track = m_ids.size(); track-- > 0;) {
+            if (m_lostFrames[track] > m_forgetDelay)
+                removeTrack(track);
+        }
+
+        for (size_t detection = 0; detection < detections.size(); ++detection) {
+            const TrackedObject &object = detections[detection];
+            if (m_detectionTracks[detection] >= 0 || object.confidence < kNewTrackScore)
+                continue;
+
+            addTrack(object.rect, timestampUs);
+            result.push_back(object);
+            result.back().object_id = (int) m_ids.back();
+            result.back().timestamp = (uint64_t) timestampUs;
+        }
+
+        return result;
+    }
+
+    void ByteTracker::trackMotions(std::vector<TrackMotion> *outTrackMotions) const {
+        const float frameIntervalS = (float) (m_frameIntervalUs / 1'000'000);
+
+        outTrackMotions->assign(m_ids.size(), TrackMotion());
+        for (size_t track = 0; track < m_ids.size(); ++track) {
+            TrackMotion &motion = (*outTrackMotions)[track];
+            motion.box = m_lastBoxes[track];
+            motion.timestampUs = m_lastSeenUs[track];
+            if (frameIntervalS > 0) {
+                motion.velocity.x = m_axes[centerX].velocity[track] / frameIntervalS;
+                motion.velocity.y = m_axes[centerY].velocity[track] / frameIntervalS;
+            }
+        }
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+/**
+ * Step the filters of all the tracks by one frame, and compute the predicted boxes.
+ */
+    void ByteTracker::predict() {
+        const size_t trackCount = m_ids.size();
+        // The noise of the horizontal coordinates scales with the width, of the vertical ones with
+        // the height, both as they were before this prediction updates them.
+        m_previousWidths.assign(m_axes[width].position.begin(), m_axes[width].position.end());
+        m_previousHeights.assign(m_axes[height].position.begin(), m_axes[height].position.end());
+        for (const Axis axis: {centerX, centerY, width, height}) {
+            KalmanAxis &filter = m_axes[axis];
+            const std::vector<float> &size = axis == centerX || axis == width ? m_previousWidths : m_previousHeights;
+            for (size_t i = 0; i < trackCount; ++i) {
+                const float positionNoise = square(kPositionNoise * size[i]);
+                const float velocityNoise = square(kVelocityNoise * size[i]);
+                filter.position[i] += filter.velocity[i];
+                filter.positionVariance[i] += 2 * filter.covariance[i] + filter.velocityVariance[i] + positionNoise;
+                filter.covariance[i] += filter.velocityVariance[i];
+                filter.velocityVariance[i] += velocityNoise;
+            }
+        }
+
+        m_x1.resize(trackCount);
+        m_y1.resize(trackCount);
+        m_x2.resize(trackCount);
+        m_y2.resize(trackCount);
+        for (size_t i = 0; i < trackCount; ++i) {
+            const float halfWidth = std::max(1.0f, m_axes[width].position[i]) / 2;
+            const float halfHeight = std::max(1.0f, m_axes[height].position[i]) / 2;
+            m_x1[i] = m_axes[centerX].position[i] - halfWidth;
+            m_y1[i] = m_axes[centerY].position[i] - halfHeight;
+            m_x2[i] = m_axes[centerX].position[i] + halfWidth;
+            m_y2[i] = m_axes[centerY].position[i] + halfHeight;
+        }
+    }
+
+/**
+ * Associate the unmatched detections with confidence in [minScore, maxScore) with the unmatched
+ * tracks, greedily from the largest IoU.
+ *
+ * @param onlyMatchedTracks Consider only the tracks matched in the previous frame.
+ */
+    void ByteTracker::associate(
+            const TrackedObjects &detections,
+            float minScore,
+            float maxScore,
+            bool onlyMatchedTracks,
+            float minIou) {
+        m_matches.clear();
+        for (size_t detection = 0; detection < detections.size(); ++detection) {
+            const TrackedObject &object = detections[detection];
+            if (m_detectionTracks[detection] >= 0 || object.confidence < minScore || object.confidence >= maxScore)
+                continue;
+
+            const float x1 = (float) object.rect.x;
+            const float y1 = (float) object.rect.y;
+            const float x2 = (float) (object.rect.x + object.rect.width);
+            const float y2 = (float) (object.rect.y + object.rect.height);
+            const float area = (x2 - x1) * (y2 - y1);
+            for (size_t track = 0; track < m_ids.size(); ++track) {
+                if (m_trackDetections[track] >= 0 || (onlyMatchedTracks && m_lostFrames[track] > 0))
+                    continue;
+
+                const float intersectionWidth = std::min(x2, m_x2[track]) - std::max(x1, m_x1[track]);
+                const float intersectionHeight = std::min(y2, m_y2[track]) - std::max(y1, m_y1[track]);
+                if (intersectionWidth <= 0 || intersectionHeight <= 0)
+                    continue;
+
+                const float intersection = intersectionWidth * intersectionHeight;
+                const float trackArea = (m_x2[track] - m_x1[track]) * (m_y2[track] - m_y1[track]);
+                const float iou = intersection / (area + trackArea - intersection);
+                if (iou >= minIou)
+                    m_matches.push_back({iou, (uint32_t) track, (uint32_t) detection});
+            }
+        }
+
+        std::sort(m_matches.begin(), m_matches.end(),
+                  [](const Match &a, const Match &b) { return a.iou > b.iou; });
+        for (const Match &match: m_matches) {
+            if (m_trackDetections[match.track] >= 0 || m_detectionTracks[match.detection] >= 0)
+                continue;
+            m_trackDetections[match.track] = (int32_t) match.detection;
+            m_detectionTracks[match.detection] = (int32_t) match.track;
+        }
+    }
+
+/**
+ * Correct the filters of the track with the matched detection.
+ */
+    void ByteTracker::update(size_t track, const cv::Rect &box) {
+        const float measurement[] = {
+                (float) box.x + (float) box.width / 2,
+                (float) box.y + (float) box.height / 2,
+                (float) box.width,
+                (float) box.height};
+        for (const Axis axis: {centerX, centerY, width, height}) {
+            KalmanAxis &filter = m_axes[axis];
+            const float measurementNoise = square(kPositionNoise * boxScale(axis, track));
+            const float innovationVariance = filter.positionVariance[track] + measurementNoise;
+            const float positionGain = filter.positionVariance[track] / innovationVariance;
+            const float velocityGain = filter.covariance[track] / innovationVariance;
+            const float innovation = measurement[axis] - filter.position[track];
+
+            filter.position[track] += positionGain * innovation;
+            filter.velocity[track] += velocityGain * innovation;
+            filter.velocityVariance[track] -= velocityGain * filter.covariance[track];
+            filter.covariance[track] *= 1 - positionGain;
+            filter.positionVariance[track] *= 1 - positionGain;
+        }
+    }
+
+    void ByteTracker::addTrack(const cv::Rect &box, int64_t timestampUs) {
+        const float measurement[] = {
+                (float) box.x + (float) box.width / 2,
+                (float) box.y + (float) box.height / 2,
+                (float) box.width,
+                (float) box.height};
+        for (const Axis axis: {centerX, centerY, width, height}) {
+            KalmanAxis &filter = m_axes[axis];
+            const float scale = (float) std::max(1, axis == centerX || axis == width ? box.width : box.height);
+            filter.position.push_back(measurement[axis]);
+            filter.velocity.push_back(0);
+            filter.positionVariance.push_back(square(2 * kPositionNoise * scale));
+            filter.covariance.push_back(0);
+            filter.velocityVariance.push_back(square(10 * kVelocityNoise * scale));
+        }
+
+        m_ids.push_back(m_nextId++);
+        m_lostFrames.push_back(0);
+        m_lastBoxes.push_back(box);
+        m_lastSeenUs.push_back(timestampUs);
+    }
+
+    void ByteTracker::removeTrack(size_t track) {
+        const auto remove =
+                [track](auto &values) {
+                    values[track] = values.back();
+                    values.pop_back();
+                };
+        for (KalmanAxis &filter: m_axes) {
+            remove(filter.position);
+            remove(filter.velocity);
+            remove(filter.positionVariance);
+            remove(filter.covariance);
+            remove(filter.velocityVariance);
+        }
+        remove(m_ids);
+        remove(m_lostFrames);
+        remove(m_lastBoxes);
+        remove(m_lastSeenUs);
+    }
+
+/**
+ * @return Size of the box of the track along the axis, which the noise is relative to.
+ */
+    float ByteTracker::boxScale(Axis axis, size_t track) const {
+        return std::max(1.0f, m_axes[axis == centerX || axis == width ? width : height].position[track]);
+    }
+
+}
@@ -0,0 +1,98 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "classification_cache.h"
+
+namespace nx_meta_plugin {
+
+//-------------------------------------------------------------------------------------------------
+// public
+
+    void ClassificationCache::setRefreshInterval(int64_t intervalUs) {
+        m_refreshIntervalUs = intervalUs;
+    }
+
+    bool ClassificationCache::lookup(const nx::sdk::Uuid &trackId, int64_t timestampUs, int *outClassId) {
+        ++m_stats.lookups;
+
+        const auto it = m_entries.find(trackId);
+        if (it == m_entries.end())
+            return false;
+
+        Entry &entry = it->second;
+        entry.lastSeenUs = timestampUs;
+
+        // A timestamp going back (the stream restarted) expires the label as well.
+        const int64_t ageUs = timestampUs - entry.classifiedUs;
+        if (!entry.certain || ageUs < 0 || ageUs >= m_refreshIntervalUs)
+            return false;
+
+        ++m_stats.hits;
+        *outClassId = entry.classId;
+        return true;
+    }
+
+    int ClassificationCache::update(
+            const nx::sdk::Uuid &trackId,
+            const Classification &classification,
+            int64_t timestampUs) {
+        Entry &entry = m_entries[trackId];
+        if (entry.votes.size() < kVoteHistorySize)
+            entry.votes.push_back(classification);
+        else
+            entry.votes[entry.nextVote] = classification;
+        entry.nextVote = (entry.nextVote + 1) % kVoteHistorySize;
+        entry.classifiedUs = timestampUs;
+        entry.lastSeenUs = timestampUs;
+
+        vote(&entry);
+        return entry.classId;
+    }
+
+    void ClassificationCache::removeStale(int64_t timestampUs) {
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            const int64_t idleUs = timestampUs - it->second.lastSeenUs;
+            if (idleUs >= kEntryLifetimeUs || idleUs < 0)
+                it = m_entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    void ClassificationCache::clear() {
+        m_entries.clear();
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+/**
+ * Set the class of the entry to the one with the most confidence among its votes, and decide
+ * whether the vote is certain. Votes for no class weigh nothing; a track with only such votes keeps
+ * the class of the last one, and is never certain, so that it is classified again on the next
+ * frame.
+ */
+    void ClassificationCache::vote(Entry *entry) {
+        float totalWeight = 0;
+        float bestWeight = 0;
+        int bestClassId = entry->votes[(entry->nextVote + kVoteHistorySize - 1) % kVoteHistorySize].classId;
+        for (const Classification &candidate: entry->votes) {
+            totalWeight += candidate.confidence;
+
+            float weight = 0;
+            for (const Classification &vote: entry->votes) {
+                if (vote.classId == candidate.classId)
+                    weight += vote.confidence;
+            }
+            if (weight > bestWeight) {
+                bestWeight = weight;
+                bestClassId = candidate.classId;
+            }
+        }
+
+        entry->classId = bestClassId;
+        entry->certain = entry->votes.size() >= kMinVotes
+                         && totalWeight > 0
+                         && bestWeight >= kCertainVoteShare * totalWeight;
+    }
+
+}
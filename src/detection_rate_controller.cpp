@@ -0,0 +1,73 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "detection_rate_controller.h"
+
+#include <algorithm>
+
+namespace nx_meta_plugin {
+
+    /** Added to the rate after every frame analyzed without a backlog. */
+    static constexpr double kRateIncreaseHz = 0.1;
+
+    /** The rate is multiplied by it when the pipeline is overloaded. */
+    static constexpr double kRateDecreaseFactor = 0.8;
+
+    /** A larger gap between frames, or a timestamp going back, restarts the selection. */
+    static constexpr int64_t kMaxFrameGapUs = 10'000'000;
+
+    DetectionRateController::DetectionRateController(double targetRateHz) :
+            m_targetRateHz(targetRateHz),
+            m_rateHz(targetRateHz) {
+    }
+
+    void DetectionRateController::setTargetRate(double targetRateHz) {
+        m_targetRateHz = targetRateHz;
+        m_rateHz = targetRateHz; //< Adapt again from the new target.
+    }
+
+    bool DetectionRateController::selectFrame(int64_t timestampUs) {
+        const int64_t frameGapUs = timestampUs - m_lastTimestampUs;
+        if (m_lastTimestampUs < 0 || frameGapUs <= 0 || frameGapUs > kMaxFrameGapUs) {
+            m_nextSelectionUs = timestampUs;
+        } else {
+            m_frameIntervalUs = m_frameIntervalUs == 0
+                                ? (double) frameGapUs
+                                : 0.9 * m_frameIntervalUs + 0.1 * (double) frameGapUs;
+        }
+        m_lastTimestampUs = timestampUs;
+
+        // Half a frame interval of tolerance: a 30 fps camera with a rate of 15 must get every
+        // second frame selected, whatever the jitter of its timestamps.
+        const double tolerance = m_frameIntervalUs / 2;
+        if ((double) timestampUs + tolerance < (double) m_nextSelectionUs)
+            return false;
+
+        // Keep the fractional part of the interval, so that any rate is met on average, but do
+        // not let a frame selected late cause a burst of selections after it.
+        const double selectionIntervalUs = 1'000'000.0 / m_rateHz;
+        m_nextSelectionUs = (int64_t) std::max(
+                (double) m_nextSelectionUs + selectionIntervalUs,
+                (double) timestampUs + selectionIntervalUs - tolerance);
+        return true;
+    }
+
+    void DetectionRateController::onFrameAnalyzed(std::chrono::microseconds latency, size_t queuedFrames) {
+        const double targetRateHz = m_targetRateHz;
+        double rateHz = m_rateHz;
+
+        const bool overloaded = queuedFrames > 1 || latency > kMaxLatency;
+        if (overloaded && m_decreaseHoldoff == 0) {
+            rateHz *= kRateDecreaseFactor;
+            // The queued frames were selected at the old rate; let them drain before judging the
+            // new one.
+            m_decreaseHoldoff = queuedFrames + 1;
+        } else if (!overloaded && queuedFrames == 0) {
+            rateHz += kRateIncreaseHz;
+        }
+        if (m_decreaseHoldoff > 0)
+            --m_decreaseHoldoff;
+
+        m_rateHz = std::max(std::min(kMinRateHz, targetRateHz), std::min(rateHz, targetRateHz));
+    }
+
+}
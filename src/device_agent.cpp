@@ -2,6 +2,7 @@
 
 #include "device_agent.h"
 
+#include <algorithm>
 #include <chrono>
 #include <exception>
 
@@ -16,6 +17,8 @@
 #include "detection.h"
 #include "exceptions.h"
 #include "frame.h"
+#include "region_proposals.h"
+#include "settings.h"
 #include "visualize.h"
 
 namespace nx_meta_plugin {
@@ -26,20 +29,34 @@ namespace nx_meta_plugin {
     using namespace std::string_literals;
 
 /**
+ * @param engine Engine which owns the models shared between all DeviceAgents.
  * @param deviceInfo Various information about the related device, such as its id, vendor, model,
  *     etc.
  */
     DeviceAgent::DeviceAgent(
+            Engine *engine,
             const nx::sdk::IDeviceInfo *deviceInfo,
             std::filesystem::path pluginHomeDir) :
     // Call the DeviceAgent helper class constructor telling it to verbosely report to stderr.
             ConsumingDeviceAgent(deviceInfo, /*enableOutput*/ true),
-            m_objectDetector(std::make_unique<YOLO11Detector>(pluginHomeDir)),
-            m_objectClassifier(std::make_unique<YOLO11Classifier>(pluginHomeDir)),
-            m_objectTracker(std::make_unique<ObjectTracker>()) {
+            m_engine(engine),
+            m_objectDetector(std::make_unique<YOLO11Detector>(
+                    pluginHomeDir, engine->modelRegistry(), engine->inferenceScheduler(), engine->modelOptions())),
+            m_objectClassifier(std::make_unique<YOLO11Classifier>(
+                    pluginHomeDir, engine->modelRegistry(), engine->modelOptions())),
+            m_detectionThread([this]() { runDetectionStage(); }),
+            m_trackingThread([this]() { runTrackingStage(); }) {
+        m_engine->onDeviceAgentCreated();
     }
 
     DeviceAgent::~DeviceAgent() {
+        // The frames still queued are released when the queues are destroyed.
+        m_frameQueue.close();
+        m_detectedFrameQueue.close();
+        m_detectionThread.join();
+        m_trackingThread.join();
+
+        m_engine->onDeviceAgentDestroyed();
     }
 
 /**
@@ -76,30 +93,27 @@ namespace nx_meta_plugin {
     }
 
 /**
- * Called when the Server sends a new uncompressed frame from a camera.
+ * Called when the Server sends a new uncompressed frame from a camera. Only queues the frame for
+ * the worker thread and returns immediately, so a slow inference never stalls frame delivery.
  */
     bool DeviceAgent::pushUncompressedVideoFrame(const IUncompressedVideoFrame *videoFrame) {
         m_terminated = m_terminated || m_objectDetector->isTerminated() || m_objectClassifier->isTerminated();
         if (m_terminated) {
-            if (!m_terminatedPrevious) {
+            if (!m_terminatedPrevious.exchange(true)) {
                 pushPluginDiagnosticEvent(
                         IPluginDiagnosticEvent::Level::error,
                         "Plugin is in broken state.",
                         "Disable the plugin.");
-                m_terminatedPrevious = true;
             }
             return true;
         }
 
         m_lastVideoFrameTimestampUs = videoFrame->timestampUs();
 
-        // Detecting objects only on every `kDetectionFramePeriod` frame.
-        if (m_frameIndex % kDetectionFramePeriod == 0) {
-            const MetadataPacketList metadataPackets = processFrame(videoFrame);
-            for (const Ptr<IMetadataPacket> &metadataPacket: metadataPackets) {
-                metadataPacket->addRef();
-                pushMetadataPacket(metadataPacket.get());
-            }
+        // Detecting objects only on the frames which keep the detection rate, by their timestamps.
+        if (m_modelsInitialized && m_detectionRateController.selectFrame(videoFrame->timestampUs())) {
+            // Hold the frame by reference (addRef), its pixels are not copied.
+            enqueueFrame({shareToPtr(videoFrame), m_frameIndex, std::chrono::steady_clock::now()});
         }
 
         ++m_frameIndex;
@@ -116,6 +130,8 @@ namespace nx_meta_plugin {
         try {
             m_objectDetector->ensureInitialized();
             m_objectClassifier->ensureInitialized();
+            m_modelsInitialized = true;
+            m_engine->reportMemoryUsage();
         }
         catch (const ObjectDetectorInitializationError &e) {
             *outValue = {ErrorCode::otherError, new String(e.what())};
@@ -126,9 +142,353 @@ namespace nx_meta_plugin {
         }
     };
 
+    Result<const ISettingsResponse *> DeviceAgent::settingsReceived() {
+        m_objectClassifier->setSizeBucketing(parseBoolSetting(
+                settingValue(kClassificationSizeBucketingSetting), kDefaultClassificationSizeBucketing));
+        m_classificationIntervalS = parseIntSetting(
+                settingValue(kClassificationIntervalSetting), kDefaultClassificationIntervalS, 0, 60);
+
+        m_detectionRateController.setTargetRate(parseIntSetting(
+                settingValue(kTargetDetectionRateSetting), kDefaultTargetDetectionRate, 1, 60));
+
+        m_sceneGatingEnabled = parseBoolSetting(
+                settingValue(kSkipUnchangedFramesSetting), kDefaultSkipUnchangedFrames);
+
+        m_motionRegionsEnabled = parseBoolSetting(
+                settingValue(kDetectMotionRegionsOnlySetting), kDefaultDetectMotionRegionsOnly);
+        m_fullFrameDetectionIntervalS = parseIntSetting(
+                settingValue(kFullFrameDetectionIntervalSetting), kDefaultFullFrameDetectionIntervalS, 1, 60);
+        m_keyframeInterval = parseIntSetting(
+                settingValue(kDetectionKeyframeIntervalSetting), kDefaultDetectionKeyframeInterval, 1, 30);
+
+        std::string tracker = settingValue(kTrackerSetting);
+        if (tracker.empty())
+            tracker = kDefaultTracker;
+        m_trackerType = tracker == kByteTrackTracker ? TrackerType::byteTrack : TrackerType::tbm;
+
+        std::string frameDropPolicy = settingValue(kFrameDropPolicySetting);
+        if (frameDropPolicy.empty())
+            frameDropPolicy = kDefaultFrameDropPolicy;
+        m_frameDropPolicy = frameDropPolicy == kDropNewestFramePolicy
+                            ? FrameDropPolicy::dropNewest
+                            : FrameDropPolicy::dropOldest;
+
+        const int tileOverlapPercent = parseIntSetting(
+                settingValue(kTileOverlapPercentSetting), kDefaultTileOverlapPercent, 0, 50);
+        const TileLayout tileLayout = TileLayout::fromString(
+                settingValue(kDetectionTilesSetting), (float) tileOverlapPercent / 100);
+        {
+            const std::lock_guard<std::mutex> lock(m_tileLayoutMutex);
+            m_tileLayout = tileLayout;
+        }
+
+        return nullptr;
+    }
+
 //-------------------------------------------------------------------------------------------------
 // private
 
+/**
+ * Put the frame into the queue, dropping a frame according to the drop policy if it is full.
+ * Called only from the Server thread.
+ */
+    void DeviceAgent::enqueueFrame(QueuedFrame queuedFrame) {
+        if (m_frameDropPolicy == FrameDropPolicy::dropNewest) {
+            if (!m_frameQueue.tryPush(queuedFrame))
+                ++m_droppedNewestFrameCount;
+        } else {
+            // Drop the oldest frame to make room, unless the detection thread has just taken it;
+            // either way there is room then, as this is the only producer.
+            if (!m_frameQueue.tryPush(queuedFrame)) {
+                QueuedFrame droppedFrame;
+                if (m_frameQueue.tryPop(&droppedFrame))
+                    ++m_droppedOldestFrameCount;
+                if (!m_frameQueue.tryPush(queuedFrame))
+                    ++m_droppedNewestFrameCount;
+            }
+        }
+
+        if (++m_enqueuedFrameCount % kDroppedFramesReportPeriod == 0)
+            reportDroppedFrames();
+    }
+
+/**
+ * Body of m_detectionThread: run the detector on the queued frames which pass the scene gate, or
+ * on their parts which have changed, and pass the results on to the tracking stage.
+ */
+    void DeviceAgent::runDetectionStage() {
+        QueuedFrame queuedFrame;
+        while (m_frameQueue.pop(&queuedFrame)) {
+            if (m_terminated)
+                continue; //< Release the queued frames without analyzing them.
+
+            const AllocationScope allocationScope(AllocationStage::detection);
+            const Frame frame(queuedFrame.videoFrame.get(), queuedFrame.index);
+            SceneGate::Decision decision = SceneGate::Decision::refresh;
+            if (m_sceneGatingEnabled || m_motionRegionsEnabled) {
+                decision = checkSceneGate(frame);
+                if (decision != SceneGate::Decision::detect && decision != SceneGate::Decision::refresh)
+                    continue;
+            }
+            if (!selectRegions(frame, decision))
+                continue;
+
+            // The memory is taken for good only when the frame is passed on.
+            DetectedFrame detectedFrame;
+            detectedFrame.memory = &m_frameMemory[m_nextFrameMemory];
+            detectedFrame.memory->reset();
+            try {
+                m_objectDetector->run(frame.cvMat, m_detectionRegions, &detectedFrame.memory->detections);
+            }
+            catch (const ObjectDetectionError &e) {
+                pushPluginDiagnosticEvent(
+                        IPluginDiagnosticEvent::Level::error,
+                        "Object detection error.",
+                        e.what());
+                m_terminated = true;
+                continue;
+            }
+
+            detectedFrame.videoFrame = std::move(queuedFrame.videoFrame);
+            detectedFrame.index = queuedFrame.index;
+            detectedFrame.selectedAt = queuedFrame.selectedAt;
+            if (!m_detectedFrameQueue.push(detectedFrame))
+                return;
+            m_nextFrameMemory = (m_nextFrameMemory + 1) % kFrameMemoryCount;
+        }
+    }
+
+/**
+ * Check the frame against the scene gate. Tells the user when the stream turns black or freezes,
+ * and prints how many inferences the gate has saved.
+ */
+    SceneGate::Decision DeviceAgent::checkSceneGate(const Frame &frame) {
+        m_sceneGate.setRefreshInterval((int64_t) m_fullFrameDetectionIntervalS * 1'000'000);
+        const SceneGate::Decision decision = m_sceneGate.check(
+                frame.cvMat, frame.timestampUs, m_trackingStage.hasActiveTracks());
+
+        const bool streamProblem =
+                decision == SceneGate::Decision::skipBlack || decision == SceneGate::Decision::skipFrozen;
+        if (streamProblem && decision != m_lastSceneGateDecision) {
+            pushPluginDiagnosticEvent(
+                    IPluginDiagnosticEvent::Level::warning,
+                    decision == SceneGate::Decision::skipBlack ? "Video is black." : "Video is frozen.",
+                    "Object detection is paused until the video changes.");
+        }
+        m_lastSceneGateDecision = decision;
+
+        const SceneGate::Stats &stats = m_sceneGate.stats();
+        if (stats.checkedFrames % kSceneGateReportPeriod == 0) {
+            NX_PRINT << "Scene gate: " << stats.savedInferences() << " of " << stats.checkedFrames
+                     << " inferences saved (" << stats.skippedStatic << " static, " << stats.skippedFrozen
+                     << " frozen, " << stats.skippedBlack << " black)";
+            if (m_tileCount > 0)
+                NX_PRINT << "Tiled detection: " << m_skippedTileCount << " of " << m_tileCount << " tiles skipped";
+            if (m_regionFrameCount > 0) {
+                NX_PRINT << "Detection regions: " << m_regionFrameCount << " frames detected on "
+                         << (int) (100 * m_regionAreaFractionSum / (double) m_regionFrameCount)
+                         << "% of their area on average";
+            }
+        }
+
+        return decision;
+    }
+
+/**
+ * Choose the parts of the frame to run the detector on into m_detectionRegions, which stays empty
+ * to detect on the whole frame.
+ *
+ * @return False if no part of the frame needs detection.
+ */
+    bool DeviceAgent::selectRegions(const Frame &frame, SceneGate::Decision decision) {
+        m_detectionRegions.clear();
+        predictTrackedRegions(frame);
+
+        // Frames not checked by the scene gate are all refreshes, which do not make keyframes.
+        const bool gated = m_sceneGatingEnabled || m_motionRegionsEnabled;
+        const bool keyframe = (gated && decision == SceneGate::Decision::refresh)
+                              || ++m_framesSinceKeyframe >= m_keyframeInterval;
+        if (keyframe) {
+            m_framesSinceKeyframe = 0;
+            if (m_motionRegionsEnabled && decision != SceneGate::Decision::refresh && selectMotionRegions(frame))
+                return !m_detectionRegions.empty();
+        } else if (selectTrackedRegions(frame)) {
+            return !m_detectionRegions.empty();
+        }
+
+        return selectTiles(frame, decision);
+    }
+
+/**
+ * Predict where the tracked objects are in the frame, from their motion published by the tracking
+ * stage, into m_trackedRegions.
+ */
+    void DeviceAgent::predictTrackedRegions(const Frame &frame) {
+        m_trackedRegions.clear();
+        m_trackingStage.trackMotions(&m_trackMotions);
+        for (const TrackMotion &trackMotion: m_trackMotions) {
+            const cv::Rect box = trackMotion.predict(frame.timestampUs);
+            const int marginX = (int) (kTrackedRegionMargin * (float) box.width);
+            const int marginY = (int) (kTrackedRegionMargin * (float) box.height);
+            m_trackedRegions.emplace_back(
+                    box.x - marginX,
+                    box.y - marginY,
+                    box.width + 2 * marginX,
+                    box.height + 2 * marginY);
+        }
+    }
+
+/**
+ * Propose crops around the predicted positions of the tracked objects as the detection regions,
+ * so that their boxes stay accurate between keyframes. New objects are found on the next keyframe.
+ *
+ * @return False if the crops would cost about as much as the whole frame.
+ */
+    bool DeviceAgent::selectTrackedRegions(const Frame &frame) {
+        const cv::Size frameSize = frame.cvMat.size();
+        if (!proposeRegions(m_trackedRegions, frameSize, &m_detectionRegions)) {
+            m_detectionRegions.clear();
+            return false;
+        }
+
+        countDetectionRegions(frameSize);
+        return true;
+    }
+
+/**
+ * Propose crops around the moving and the tracked objects as the detection regions.
+ *
+ * @return False if the crops would cost about as much as the whole frame.
+ */
+    bool DeviceAgent::selectMotionRegions(const Frame &frame) {
+        const cv::Size frameSize = frame.cvMat.size();
+        m_changedRegions = m_sceneGate.changedRegions(frameSize);
+        m_changedRegions.insert(m_changedRegions.end(), m_trackedRegions.begin(), m_trackedRegions.end());
+
+        if (!proposeRegions(m_changedRegions, frameSize, &m_detectionRegions)) {
+            m_detectionRegions.clear();
+            return false;
+        }
+
+        countDetectionRegions(frameSize);
+        return true;
+    }
+
+/**
+ * Choose the tiles of the frame as the detection regions, if the frame is tiled. Unless the scene
+ * gate asks for a refresh, only the tiles with changed pixels or tracked objects are kept.
+ *
+ * @return False if no tile needs detection.
+ */
+    bool DeviceAgent::selectTiles(const Frame &frame, SceneGate::Decision decision) {
+        TileLayout tileLayout;
+        {
+            const std::lock_guard<std::mutex> lock(m_tileLayoutMutex);
+            tileLayout = m_tileLayout;
+        }
+
+        if (!tileLayout.isTiled())
+            return true;
+
+        const cv::Size frameSize = frame.cvMat.size();
+        m_detectionRegions = makeTiles(frameSize, tileLayout);
+        m_tileCount += m_detectionRegions.size();
+        if (decision == SceneGate::Decision::refresh)
+            return true;
+
+        std::vector<cv::Rect> &tiles = m_detectionRegions;
+        const size_t tileCount = tiles.size();
+        tiles.erase(std::remove_if(tiles.begin(), tiles.end(),
+                                   [&](const cv::Rect &tile) {
+                                       if (m_sceneGate.hasChangedPixels(tile, frameSize))
+                                           return false;
+                                       return std::none_of(m_trackedRegions.begin(), m_trackedRegions.end(),
+                                                           [&tile](const cv::Rect &region) {
+                                                               return (region & tile).area() > 0;
+                                                           });
+                                   }),
+                    tiles.end());
+        m_skippedTileCount += tileCount - tiles.size();
+        return !tiles.empty();
+    }
+
+    void DeviceAgent::countDetectionRegions(const cv::Size &frameSize) {
+        double area = 0;
+        for (const cv::Rect &region: m_detectionRegions)
+            area += region.area();
+        ++m_regionFrameCount;
+        m_regionAreaFractionSum += area / frameSize.area();
+    }
+
+/**
+ * Body of m_trackingThread: track and classify the detected objects in frame order, push the
+ * metadata with the timestamps of the frames they were produced from, and let the detection rate
+ * follow the load of the pipeline.
+ */
+    void DeviceAgent::runTrackingStage() {
+        DetectedFrame detectedFrame;
+        while (m_detectedFrameQueue.pop(&detectedFrame)) {
+            if (m_terminated)
+                continue;
+
+            const Ptr<ObjectMetadataPacket> objectMetadataPacket = trackAndClassify(detectedFrame);
+            if (objectMetadataPacket) {
+                objectMetadataPacket->addRef();
+                pushMetadataPacket(objectMetadataPacket.get());
+            }
+            if (kCountAllocations)
+                reportAllocations();
+
+            m_detectionRateController.onFrameAnalyzed(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - detectedFrame.selectedAt),
+                    m_frameQueue.size() + m_detectedFrameQueue.size());
+        }
+    }
+
+/**
+ * Print the allocations per frame of every stage, measured from the end of the first report period
+ * on, when the tracks and the buffers have settled.
+ */
+    void DeviceAgent::reportAllocations() {
+        m_allocationMonitor.onFrame();
+        if (m_allocationMonitor.frames() % kAllocationReportPeriod != 0)
+            return;
+
+        if (!m_allocationMonitorStarted) {
+            m_allocationMonitor.start();
+            m_allocationMonitorStarted = true;
+            return;
+        }
+
+        const AllocationMonitor &monitor = m_allocationMonitor;
+        NX_PRINT << "Allocations per frame: "
+                 << monitor.allocationsPerFrame(AllocationStage::detection) << " detection, "
+                 << monitor.allocationsPerFrame(AllocationStage::tracking) << " tracking, "
+                 << monitor.allocationsPerFrame(AllocationStage::classification) << " classification, "
+                 << monitor.allocationsPerFrame(AllocationStage::metadata) << " metadata, "
+                 << monitor.allocationsPerFrame(AllocationStage::other) << " other";
+    }
+
+/**
+ * Print the drop counters, and tell the user once when frames start being dropped.
+ */
+    void DeviceAgent::reportDroppedFrames() {
+        const uint64_t droppedOldest = m_droppedOldestFrameCount;
+        const uint64_t droppedNewest = m_droppedNewestFrameCount;
+        NX_PRINT << "Frame queue: " << m_enqueuedFrameCount << " frames queued, "
+                 << droppedOldest << " oldest and " << droppedNewest << " newest dropped";
+
+        if (droppedOldest + droppedNewest > 0 && !m_dropReported) {
+            pushPluginDiagnosticEvent(
+                    IPluginDiagnosticEvent::Level::warning,
+                    "Frames are dropped.",
+                    "Object detection cannot keep up with the frame rate of the camera; "
+                    + std::to_string(droppedOldest + droppedNewest) + " frames have not been analyzed.");
+            m_dropReported = true;
+        }
+    }
+
     Ptr<IMetadataPacket> DeviceAgent::generateEventMetadataPacket() {
         // Generate event every kTrackFrameCount'th frame.
         if (m_frameIndex % kTrackFrameCount != 0)
@@ -157,107 +517,19 @@ namespace nx_meta_plugin {
         return eventMetadataPacket;
     }
 
-    Ptr<ObjectMetadataPacket> DeviceAgent::detectionsToObjectMetadataPacket(
-            const DetectionList &detections,
-            int64_t timestampUs) {
-        if (detections.empty())
-            return nullptr;
-
-        const auto objectMetadataPacket = makePtr<ObjectMetadataPacket>();
-
-        for (const std::shared_ptr<Detection> &detection: detections) {
-            const auto objectMetadata = makePtr<ObjectMetadata>();
-
-            objectMetadata->setBoundingBox(detection->boundingBox);
-            objectMetadata->setConfidence(detection->confidence);
-            objectMetadata->setTrackId(detection->trackId);
-
-            // Convert class label to object metadata type id.
-            if (detection->classLabel == "person")
-                objectMetadata->setTypeId(kPersonObjectType);
-            else if (detection->classLabel == "cat")
-                objectMetadata->setTypeId(kCatObjectType);
-            else if (detection->classLabel == "dog")
-                objectMetadata->setTypeId(kDogObjectType);
-            else if (detection->classLabel == "CA") {
-                objectMetadata->setTypeId(kPersonObjectType);
-                objectMetadata->addAttribute(nx::sdk::makePtr<Attribute>(IAttribute::Type::string, "Type", "CA"));
-                objectMetadata->addAttribute(nx::sdk::makePtr<Attribute>(IAttribute::Type::string, "TrackID",
-                                                                         UuidHelper::toStdString(detection->trackId)));
-                objectMetadata->addAttribute(makePtr<Attribute>(Attribute::Type::string, "nx.sys.color", "Green"));
-            } else if (detection->classLabel == "PN") {
-                objectMetadata->setTypeId(kPersonObjectType);
-                objectMetadata->addAttribute(nx::sdk::makePtr<Attribute>(IAttribute::Type::string, "Type", "PN"));
-                objectMetadata->addAttribute(nx::sdk::makePtr<Attribute>(IAttribute::Type::string, "TrackID",
-                                                                         UuidHelper::toStdString(detection->trackId)));
-                objectMetadata->addAttribute(makePtr<Attribute>(Attribute::Type::string, "nx.sys.color", "Red"));
-            } else if (detection->classLabel == "Unknown") {
-                objectMetadata->setTypeId(kPersonObjectType);
-                objectMetadata->setSubtype("Unknown");
-                objectMetadata->addAttribute(nx::sdk::makePtr<Attribute>(IAttribute::Type::string, "Type", "Unknown"));
-                objectMetadata->addAttribute(nx::sdk::makePtr<Attribute>(IAttribute::Type::string, "TrackID",
-                                                                         UuidHelper::toStdString(detection->trackId)));
-                objectMetadata->addAttribute(makePtr<Attribute>(Attribute::Type::string, "nx.sys.color", "Yellow"));
-            }
-            // There is no "else", because only the detections with those types are generated.
-
-            objectMetadataPacket->addItem(objectMetadata.get());
-        }
-        objectMetadataPacket->setTimestampUs(timestampUs);
-
-        return objectMetadataPacket;
-    }
-
-    void DeviceAgent::reinitializeObjectTrackerOnFrameSizeChanges(const Frame &frame) {
-        const bool frameSizeUnset = m_previousFrameWidth == 0 && m_previousFrameHeight == 0;
-        if (frameSizeUnset) {
-            m_previousFrameWidth = frame.width;
-            m_previousFrameHeight = frame.height;
-            return;
-        }
-
-        const bool frameSizeChanged = frame.width != m_previousFrameWidth ||
-                                      frame.height != m_previousFrameHeight;
-        if (frameSizeChanged) {
-            m_objectTracker = std::make_unique<ObjectTracker>();
-            m_previousFrameWidth = frame.width;
-            m_previousFrameHeight = frame.height;
-        }
-    }
-
-    DeviceAgent::MetadataPacketList DeviceAgent::processFrame(
-            const IUncompressedVideoFrame *videoFrame) {
-        const Frame frame(videoFrame, m_frameIndex);
-        reinitializeObjectTrackerOnFrameSizeChanges(frame);
+/**
+ * Run the tracking stage on the frame with the current settings.
+ *
+ * @return Null if there is nothing to push, or the stage has failed.
+ */
+    Ptr<ObjectMetadataPacket> DeviceAgent::trackAndClassify(const DetectedFrame &detectedFrame) {
+        const Frame frame(detectedFrame.videoFrame.get(), detectedFrame.index);
+        m_trackingStage.setTrackerType(m_trackerType);
+        m_trackingStage.setClassificationInterval((int64_t) m_classificationIntervalS * 1'000'000);
+        m_trackingStage.setDetectionRate(m_detectionRateController.rateHz());
 
         try {
-            cv::Mat image = frame.cvMat;
-            DetectionList detections = m_objectDetector->run(image);
-            detections = m_objectTracker->run(frame, detections);
-
-            std::cout << "Number people: " << detections.size() << std::endl;
-            const cv::Size originalImageSize = image.size();
-            for (auto detection: detections) {
-                cv::Rect boundingBox = nxRectToCvRect(detection->boundingBox, originalImageSize.width,
-                                                      originalImageSize.height);
-                cv::Mat cropped_image = image(boundingBox).clone();
-                cv::resize(cropped_image, cropped_image, cv::Size(640, 640));
-                std::string classLabel = m_objectClassifier->run(image);
-                detection->classLabel = classLabel;
-                std::cout << "label: " << detection->classLabel << std::endl;
-            }
-
-//            if (!detections.empty()) {
-//                drawBoundingBox(image, detections[0]);
-//            }
-
-            const auto &objectMetadataPacket =
-                    detectionsToObjectMetadataPacket(detections, frame.timestampUs);
-            MetadataPacketList result;
-            if (objectMetadataPacket)
-                result.push_back(objectMetadataPacket);
-            std::cout << "Number objectMetadataPacket: " << result.size() << std::endl;
-            return result;
+            return m_trackingStage.run(frame, detectedFrame.memory);
         }
         catch (const ObjectDetectionError &e) {
             pushPluginDiagnosticEvent(
@@ -274,7 +546,7 @@ namespace nx_meta_plugin {
             m_terminated = true;
         }
 
-        return {};
+        return nullptr;
     }
 
 }
@@ -2,7 +2,16 @@
 
 #include "engine.h"
 
+#include <fstream>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include <nx/kit/debug.h>
+
 #include "device_agent.h"
+#include "settings.h"
 
 namespace nx_meta_plugin {
 
@@ -18,6 +27,50 @@ namespace nx_meta_plugin {
     Engine::~Engine() {
     }
 
+    ModelOptions Engine::modelOptions() const {
+        ModelOptions result;
+        result.preferInt8 = m_preferInt8Models;
+        return result;
+    }
+
+    void Engine::onDeviceAgentCreated() {
+        ++m_deviceAgentCount;
+    }
+
+    void Engine::onDeviceAgentDestroyed() {
+        --m_deviceAgentCount;
+    }
+
+/**
+ * @return Resident set size of the process, or 0 if it cannot be determined on this platform.
+ */
+    static uintmax_t residentMemoryBytes() {
+#if defined(__linux__)
+        // The second field of statm is the number of resident pages.
+        std::ifstream statm("/proc/self/statm");
+        uintmax_t totalPages = 0;
+        uintmax_t residentPages = 0;
+        if (statm >> totalPages >> residentPages)
+            return residentPages * (uintmax_t) sysconf(_SC_PAGESIZE);
+#endif
+        return 0;
+    }
+
+    void Engine::reportMemoryUsage() const {
+        static constexpr double kMiB = 1024.0 * 1024.0;
+
+        const ModelRegistry::Stats stats = m_modelRegistry->stats();
+        const int cameraCount = std::max(1, m_deviceAgentCount.load());
+        const double residentMiB = (double) residentMemoryBytes() / kMiB;
+
+        NX_PRINT << "Memory usage: " << residentMiB << " MiB resident, "
+                 << m_deviceAgentCount.load() << " camera(s), "
+                 << residentMiB / cameraCount << " MiB per camera; "
+                 << stats.sessionCount << " model session(s) ("
+                 << (double) stats.modelFileBytes / kMiB << " MiB of model files) shared by "
+                 << stats.handleCount << " handle(s)";
+    }
+
 /**
  * Called when the Server opens a video-connection to the camera if the plugin is enabled for this
  * camera.
@@ -28,7 +81,7 @@ namespace nx_meta_plugin {
  *     model, etc.
  */
     void Engine::doObtainDeviceAgent(Result<IDeviceAgent *> *outResult, const IDeviceInfo *deviceInfo) {
-        *outResult = new DeviceAgent(deviceInfo, m_pluginHomeDir);
+        *outResult = new DeviceAgent(this, deviceInfo, m_pluginHomeDir);
     }
 
 /**
@@ -37,12 +90,153 @@ namespace nx_meta_plugin {
  */
     std::string Engine::manifestString() const {
         // Ask the Server to supply uncompressed video frames in BGR format, as it is native format for
-        // OpenCV.
+        // OpenCV. The deviceAgentSettingsModel describes the settings of each camera.
         return /*suppress newline*/ 1 + R"json(
 {
-    "capabilities": "needUncompressedVideoFrames_bgr"
+    "capabilities": "needUncompressedVideoFrames_bgr",
+    "deviceAgentSettingsModel": {
+        "type": "Settings",
+        "items": [
+            {
+                "type": "GroupBox",
+                "caption": "Classification",
+                "items": [
+                    {
+                        "type": "CheckBox",
+                        "name": ")json" + kClassificationSizeBucketingSetting + R"json(",
+                        "caption": "Classify small people at a smaller input size",
+                        "description": "Requires a classification model with dynamic input height and width",
+                        "defaultValue": )json" + (kDefaultClassificationSizeBucketing ? "true" : "false") + R"json(
+                    },
+                    {
+                        "type": "SpinBox",
+                        "name": ")json" + kClassificationIntervalSetting + R"json(",
+                        "caption": "Re-classify tracked people every N seconds",
+                        "description": "A tracked person keeps their label in between, unless the label is uncertain. 0 classifies every person on every frame",
+                        "defaultValue": )json" + std::to_string(kDefaultClassificationIntervalS) + R"json(,
+                        "minValue": 0,
+                        "maxValue": 60
+                    }
+                ]
+            },
+            {
+                "type": "GroupBox",
+                "caption": "Frame analysis",
+                "items": [
+                    {
+                        "type": "SpinBox",
+                        "name": ")json" + kTargetDetectionRateSetting + R"json(",
+                        "caption": "Detection rate (frames per second)",
+                        "description": "Detection runs on up to this many frames per second, fewer if the host cannot keep up",
+                        "defaultValue": )json" + std::to_string(kDefaultTargetDetectionRate) + R"json(,
+                        "minValue": 1,
+                        "maxValue": 60
+                    },
+                    {
+                        "type": "CheckBox",
+                        "name": ")json" + kSkipUnchangedFramesSetting + R"json(",
+                        "caption": "Skip detection on unchanged frames",
+                        "description": "Do not run detection on black, frozen or static frames while nothing is tracked",
+                        "defaultValue": )json" + (kDefaultSkipUnchangedFrames ? "true" : "false") + R"json(
+                    },
+                    {
+                        "type": "ComboBox",
+                        "name": ")json" + kFrameDropPolicySetting + R"json(",
+                        "caption": "When analysis falls behind",
+                        "description": "Which frame to drop when the queue of frames waiting for analysis is full",
+                        "items": [")json" + kDropOldestFramePolicy + R"json(", ")json" + kDropNewestFramePolicy + R"json("],
+                        "itemCaptions": {
+                            ")json" + kDropOldestFramePolicy + R"json(": "Drop the oldest queued frame",
+                            ")json" + kDropNewestFramePolicy + R"json(": "Drop the new frame"
+                        },
+                        "defaultValue": ")json" + kDefaultFrameDropPolicy + R"json("
+                    },
+                    {
+                        "type": "ComboBox",
+                        "name": ")json" + kDetectionTilesSetting + R"json(",
+                        "caption": "Detection tiles",
+                        "description": "Split high-resolution frames into overlapping tiles (columns x rows), so that small distant people are detected; tiles without motion or tracks are skipped",
+                        "items": ["1x1", "2x1", "2x2", "3x2", "3x3", "4x3"],
+                        "itemCaptions": {
+                            "1x1": "Whole frame",
+                            "2x1": "2 x 1",
+                            "2x2": "2 x 2",
+                            "3x2": "3 x 2",
+                            "3x3": "3 x 3",
+                            "4x3": "4 x 3"
+                        },
+                        "defaultValue": ")json" + kDefaultDetectionTiles + R"json("
+                    },
+                    {
+                        "type": "SpinBox",
+                        "name": ")json" + kTileOverlapPercentSetting + R"json(",
+                        "caption": "Tile overlap (%)",
+                        "description": "Overlap of neighbouring tiles; objects smaller than the overlap are seen whole by at least one tile",
+                        "defaultValue": )json" + std::to_string(kDefaultTileOverlapPercent) + R"json(,
+                        "minValue": 0,
+                        "maxValue": 50
+                    },
+                    {
+                        "type": "CheckBox",
+                        "name": ")json" + kDetectMotionRegionsOnlySetting + R"json(",
+                        "caption": "Detect only in motion regions",
+                        "description": "Run detection only on crops around moving and tracked objects, with a full-frame pass at the interval below; implies skipping unchanged frames",
+                        "defaultValue": )json" + (kDefaultDetectMotionRegionsOnly ? "true" : "false") + R"json(
+                    },
+                    {
+                        "type": "SpinBox",
+                        "name": ")json" + kFullFrameDetectionIntervalSetting + R"json(",
+                        "caption": "Full-frame detection interval (s)",
+                        "description": "How often detection runs on the whole frame when unchanged frames or motion regions are skipped, so that people standing still are found",
+                        "defaultValue": )json" + std::to_string(kDefaultFullFrameDetectionIntervalS) + R"json(,
+                        "minValue": 1,
+                        "maxValue": 60
+                    },
+                    {
+                        "type": "SpinBox",
+                        "name": ")json" + kDetectionKeyframeIntervalSetting + R"json(",
+                        "caption": "Full-frame detection every N analyzed frames",
+                        "description": "On the frames in between, detection runs only on crops around the predicted positions of the tracked objects; new objects are found on the next full frame. 1 detects every frame whole",
+                        "defaultValue": )json" + std::to_string(kDefaultDetectionKeyframeInterval) + R"json(,
+                        "minValue": 1,
+                        "maxValue": 30
+                    },
+                    {
+                        "type": "ComboBox",
+                        "name": ")json" + kTrackerSetting + R"json(",
+                        "caption": "Tracker",
+                        "description": "Matching by appearance and motion (tbm), or by motion only (ByteTrack), which is much cheaper in crowds",
+                        "items": [")json" + kTbmTracker + R"json(", ")json" + kByteTrackTracker + R"json("],
+                        "itemCaptions": {
+                            ")json" + kTbmTracker + R"json(": "Appearance and motion (tbm)",
+                            ")json" + kByteTrackTracker + R"json(": "Motion only (ByteTrack)"
+                        },
+                        "defaultValue": ")json" + kDefaultTracker + R"json("
+                    }
+                ]
+            }
+        ]
+    }
 }
 )json";
     }
 
+    Result<const ISettingsResponse *> Engine::settingsReceived() {
+        const int idleTimeoutS = parseIntSetting(
+                settingValue(kModelIdleTimeoutSetting), kDefaultModelIdleTimeoutS, 0, 24 * 60 * 60);
+        m_modelRegistry->setIdleTimeout(std::chrono::seconds(idleTimeoutS));
+
+        // Applies to the models loaded from now on; models already in use are not reloaded.
+        m_preferInt8Models = parseBoolSetting(settingValue(kPreferInt8ModelsSetting), kDefaultPreferInt8Models);
+
+        InferenceScheduler::Options schedulerOptions;
+        schedulerOptions.maxBatchSize = parseIntSetting(
+                settingValue(kDetectionMaxBatchSizeSetting), kDefaultDetectionMaxBatchSize, 1, 64);
+        schedulerOptions.maxWait = std::chrono::milliseconds(parseIntSetting(
+                settingValue(kDetectionMaxWaitMsSetting), kDefaultDetectionMaxWaitMs, 0, 1000));
+        m_inferenceScheduler->setOptions(schedulerOptions);
+
+        return nullptr;
+    }
+
 }
@@ -0,0 +1,77 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <new>
+
+namespace nx_meta_plugin {
+
+//-------------------------------------------------------------------------------------------------
+// public
+
+    FrameArena::FrameArena(size_t initialCapacity) :
+            m_block(std::make_unique<std::byte[]>(initialCapacity)),
+            m_capacity(initialCapacity) {
+    }
+
+    FrameArena::~FrameArena() {
+        freeOverflows();
+    }
+
+/**
+ * Grow the block to a power of two which holds everything the frame took, if it did not fit.
+ */
+    void FrameArena::reset() {
+        ++m_stats.frames;
+        if (!m_overflows.empty()) {
+            ++m_stats.overflowedFrames;
+            const size_t needed = m_used + m_overflowBytes;
+            freeOverflows();
+
+            size_t capacity = std::max<size_t>(m_capacity, 1);
+            while (capacity < needed)
+                capacity *= 2;
+            m_block = std::make_unique<std::byte[]>(capacity);
+            m_capacity = capacity;
+        }
+        m_used = 0;
+    }
+
+//-------------------------------------------------------------------------------------------------
+// protected
+
+    void *FrameArena::do_allocate(size_t bytes, size_t alignment) {
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(m_block.get());
+        const uintptr_t aligned = (begin + m_used + alignment - 1) & ~(uintptr_t) (alignment - 1);
+        const size_t offset = (size_t) (aligned - begin);
+        if (offset + bytes <= m_capacity) {
+            m_used = offset + bytes;
+            return m_block.get() + offset;
+        }
+
+        void *const p = ::operator new(bytes, std::align_val_t(alignment));
+        m_overflows.push_back({p, bytes, alignment});
+        m_overflowBytes += bytes + alignment; //< Room for aligning it in the grown block.
+        return p;
+    }
+
+    void FrameArena::do_deallocate(void * /*p*/, size_t /*bytes*/, size_t /*alignment*/) {
+        // Freed all at once by reset().
+    }
+
+    bool FrameArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+        return this == &other;
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+    void FrameArena::freeOverflows() {
+        for (const Overflow &overflow: m_overflows)
+            ::operator delete(overflow.p, overflow.bytes, std::align_val_t(overflow.alignment));
+        m_overflows.clear();
+        m_overflowBytes = 0;
+    }
+
+}
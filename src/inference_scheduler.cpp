@@ -0,0 +1,266 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "inference_scheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <nx/kit/debug.h>
+
+#include "geometry.h"
+
+namespace nx_meta_plugin {
+
+    /** Histograms are printed and reset every kStatsReportPeriod batches. */
+    static constexpr uint64_t kStatsReportPeriod = 1000;
+
+    InferenceScheduler::InferenceScheduler() :
+            m_thread([this]() { processBatches(); }) {
+    }
+
+    InferenceScheduler::~InferenceScheduler() {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopped = true;
+        }
+        m_submitted.notify_all();
+        m_thread.join();
+    }
+
+    void InferenceScheduler::setOptions(const Options &options) {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_options = options;
+        }
+        m_submitted.notify_all();
+    }
+
+    bool InferenceScheduler::isBatchingEnabled(const ModelSession &session) const {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        return session.isDynamicBatchSize && m_options.maxBatchSize > 1;
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+    void InferenceScheduler::run(
+            const std::shared_ptr<ModelSession> &session,
+            const std::vector<int64_t> &inputShape,
+            Client *client) {
+        // The request lives on the stack of the calling thread, which is blocked until the
+        // scheduler thread marks it as done, and releases it after reading its output.
+        Request request;
+        request.session = &session;
+        request.inputShape = &inputShape;
+        request.enqueuedAt = Clock::now();
+
+        std::exception_ptr callbackError;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stopped)
+            throw std::runtime_error("Inference scheduler is stopped.");
+
+        m_queue.push_back(&request);
+        m_submitted.notify_one();
+        m_completed.wait(lock, [&request]() { return request.state != RequestState::queued; });
+
+        if (request.state == RequestState::writing) {
+            // The batch waits for its slot even if the input cannot be written.
+            lock.unlock();
+            try {
+                client->writeInput(request.input);
+            }
+            catch (...) {
+                callbackError = std::current_exception();
+            }
+            lock.lock();
+            request.state = RequestState::written;
+            --request.buffers->unwrittenCount;
+            m_submitted.notify_one();
+            m_completed.wait(lock, [&request]() { return request.state == RequestState::done; });
+        }
+
+        if (request.buffers) {
+            if (!request.error && !callbackError) {
+                lock.unlock();
+                try {
+                    client->readOutput(request.output, request.buffers->requestOutputShape);
+                }
+                catch (...) {
+                    callbackError = std::current_exception();
+                }
+                lock.lock();
+            }
+            request.state = RequestState::released;
+            --request.buffers->unreleasedCount;
+            m_submitted.notify_one();
+        }
+        lock.unlock();
+
+        if (request.error)
+            std::rethrow_exception(request.error);
+        if (callbackError)
+            std::rethrow_exception(callbackError);
+    }
+
+    void InferenceScheduler::processBatches() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_submitted.wait(lock, [this]() { return m_stopped || !m_queue.empty(); });
+            if (m_stopped)
+                break;
+
+            // Give other cameras a chance to join the batch, but never make the oldest request
+            // wait longer than maxWait.
+            const Request *first = m_queue.front();
+            const size_t maxBatchSize = (*first->session)->isDynamicBatchSize
+                                        ? (size_t) std::max(1, m_options.maxBatchSize)
+                                        : 1;
+            const Clock::time_point deadline = first->enqueuedAt + m_options.maxWait;
+            m_submitted.wait_until(lock, deadline,
+                                   [this, maxBatchSize]() {
+                                       return m_stopped || countCompatibleRequests() >= maxBatchSize;
+                                   });
+            if (m_stopped)
+                break;
+
+            const Clock::time_point batchStartTime = Clock::now();
+            m_batch.clear();
+            for (auto it = m_queue.begin(); it != m_queue.end() && m_batch.size() < maxBatchSize;) {
+                if (isCompatible(*first, **it)) {
+                    m_waitTimeMsHistogram.add(
+                            std::chrono::duration<double, std::milli>(batchStartTime - (*it)->enqueuedAt).count());
+                    m_batch.push_back(*it);
+                    it = m_queue.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            m_batchSizeHistogram.add((double) m_batch.size());
+
+            // The buffers are reused only once the callers of their previous batch have read
+            // their output.
+            BatchBuffers *const buffers = &m_buffers[m_nextBuffers];
+            m_nextBuffers = (m_nextBuffers + 1) % m_buffers.size();
+            m_submitted.wait(lock, [buffers]() { return buffers->unreleasedCount == 0; });
+            for (Request *request: m_batch)
+                request->buffers = buffers;
+            buffers->unreleasedCount = m_batch.size();
+
+            lock.unlock();
+            std::exception_ptr error;
+            float *input = nullptr;
+            try {
+                input = prepareBatchInput(buffers, m_batch);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+
+            if (!error) {
+                // Let the callers fill their slots, and run the batch once all of them are filled.
+                const size_t inputSize = vectorProduct(*first->inputShape);
+                for (size_t i = 0; i < m_batch.size(); ++i) {
+                    m_batch[i]->input = input + i * inputSize;
+                    m_batch[i]->state = RequestState::writing;
+                }
+                buffers->unwrittenCount = m_batch.size();
+                m_completed.notify_all();
+                m_submitted.wait(lock, [buffers]() { return buffers->unwrittenCount == 0; });
+
+                lock.unlock();
+                try {
+                    buffers->boundSession->run();
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+                lock.lock();
+            }
+
+            finishBatch(buffers, error);
+
+            if (m_batchSizeHistogram.count() >= kStatsReportPeriod)
+                reportStats();
+        }
+
+        // Fail the requests that were not processed, so that no caller stays blocked, and keep the
+        // buffers until the callers of the last batches have read their output.
+        for (Request *request: m_queue) {
+            request->error = std::make_exception_ptr(std::runtime_error("Inference scheduler is stopped."));
+            request->state = RequestState::done;
+        }
+        m_queue.clear();
+        m_completed.notify_all();
+        for (const BatchBuffers &buffers: m_buffers)
+            m_submitted.wait(lock, [&buffers]() { return buffers.unreleasedCount == 0; });
+    }
+
+    bool InferenceScheduler::isCompatible(const Request &first, const Request &other) const {
+        return *first.session == *other.session && *first.inputShape == *other.inputShape;
+    }
+
+/**
+ * @return Number of queued requests which can be put into one batch with the oldest request. Must
+ *     be called with m_mutex locked.
+ */
+    size_t InferenceScheduler::countCompatibleRequests() const {
+        if (m_queue.empty())
+            return 0;
+        return (size_t) std::count_if(m_queue.begin(), m_queue.end(),
+                                      [this](const Request *request) {
+                                          return isCompatible(*m_queue.front(), *request);
+                                      });
+    }
+
+/**
+ * Bind the buffers to the session of the batch if they are not bound to it yet.
+ *
+ * @return Batch input, with the inputs of the requests one after another.
+ */
+    float *InferenceScheduler::prepareBatchInput(BatchBuffers *buffers, const std::vector<Request *> &batch) {
+        const std::shared_ptr<ModelSession> &session = *batch.front()->session;
+        if (!buffers->boundSession || buffers->session.lock() != session) {
+            buffers->boundSession = std::make_unique<BoundSession>(session.get());
+            buffers->session = session;
+        }
+
+        std::vector<int64_t> batchInputShape = *batch.front()->inputShape;
+        batchInputShape[0] = (int64_t) batch.size();
+        return buffers->boundSession->input(batchInputShape);
+    }
+
+/**
+ * Give every request of the batch its output slot, or the error, and wake the callers up. Must be
+ * called with m_mutex locked.
+ */
+    void InferenceScheduler::finishBatch(BatchBuffers *buffers, const std::exception_ptr &error) {
+        if (!error) {
+            const float *const output = buffers->boundSession->output();
+            buffers->requestOutputShape = buffers->boundSession->outputShape();
+            const size_t outputSize = vectorProduct(buffers->requestOutputShape) / m_batch.size();
+            buffers->requestOutputShape[0] = 1;
+            for (size_t i = 0; i < m_batch.size(); ++i)
+                m_batch[i]->output = output + i * outputSize;
+        }
+
+        for (Request *request: m_batch) {
+            request->error = error;
+            request->state = RequestState::done;
+        }
+        m_completed.notify_all();
+    }
+
+/**
+ * Print and reset the histograms. Must be called with m_mutex locked.
+ */
+    void InferenceScheduler::reportStats() {
+        NX_PRINT << "Inference scheduler: mean batch size " << m_batchSizeHistogram.mean()
+                 << ", batch sizes {" << m_batchSizeHistogram.toString() << "}"
+                 << "; mean wait " << m_waitTimeMsHistogram.mean() << " ms"
+                 << ", wait times (ms) {" << m_waitTimeMsHistogram.toString() << "}";
+        m_batchSizeHistogram.reset();
+        m_waitTimeMsHistogram.reset();
+    }
+
+}
@@ -3,6 +3,7 @@
 #include <string>
 
 #include "device_agent.h"
+#include "engine.h"
 #include <filesystem>
 #include <opencv2/highgui/highgui.hpp>
 #include <nx/sdk/analytics/helpers/consuming_device_agent.h>
@@ -125,7 +126,8 @@ int main() {
     nx::sdk::Ptr<nx::sdk::IDeviceInfo> deviceInfo(
             new MockDeviceInfo("mock_device_001", "MockVendor", "VirtualCamera_Model_X"));
     const nx::sdk::IDeviceInfo *deviceInfoInterface = deviceInfo.get();
-    nx_meta_plugin::DeviceAgent deviceAgent(deviceInfoInterface, pluginHomeDir);
+    nx::sdk::Ptr<nx_meta_plugin::Engine> engine(new nx_meta_plugin::Engine(pluginHomeDir));
+    nx_meta_plugin::DeviceAgent deviceAgent(engine.get(), deviceInfoInterface, pluginHomeDir);
     nx::sdk::Result<void> *outValue;
     const nx::sdk::analytics::IMetadataTypes *neededMetadataTypes;
     deviceAgent.doSetNeededMetadataTypes(outValue, neededMetadataTypes);
@@ -0,0 +1,243 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "model_registry.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "exceptions.h"
+
+namespace nx_meta_plugin {
+
+    std::string ModelOptions::key() const {
+        return std::to_string(intraOpNumThreads) + (useGpu ? ":gpu" : ":cpu");
+    }
+
+    ModelRegistry::ModelRegistry() :
+            m_env(ORT_LOGGING_LEVEL_WARNING, "ONNX_DETECTION") {
+        // Register one arena allocator in the Env, so that all the sessions use it instead of
+        // creating a separate arena per session.
+        const Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        const Ort::ArenaCfg arenaCfg(/*max_mem*/ 0, /*arena_extend_strategy*/ -1,
+                /*initial_chunk_size_bytes*/ -1, /*max_dead_bytes_per_chunk*/ -1);
+        m_env.CreateAndRegisterAllocator(memoryInfo, arenaCfg);
+
+        m_evictionThread = std::thread(
+                [this]() {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    while (!m_stopped) {
+                        evictIdleSessions();
+
+                        // Sleep until the earliest idle session expires, or until something changes.
+                        Clock::time_point wakeUpTime = Clock::time_point::max();
+                        for (const auto &[key, entry]: m_entries) {
+                            if (entry.handleCount == 0)
+                                wakeUpTime = std::min(wakeUpTime, entry.idleSince + m_idleTimeout);
+                        }
+                        if (wakeUpTime == Clock::time_point::max())
+                            m_condition.wait(lock);
+                        else
+                            m_condition.wait_until(lock, wakeUpTime);
+                    }
+                });
+    }
+
+    ModelRegistry::~ModelRegistry() {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopped = true;
+        }
+        m_condition.notify_all();
+        m_evictionThread.join();
+
+        // Sessions must be destroyed before the Env they were created in.
+        m_entries.clear();
+    }
+
+    std::shared_ptr<ModelSession> ModelRegistry::acquire(
+            const std::filesystem::path &modelPath,
+            const ModelOptions &options) {
+        const std::filesystem::path resolvedModelPath = resolveModelPath(modelPath, options);
+        const std::string key = resolvedModelPath.u8string() + "|" + options.key();
+
+        // The lock is held while the model is being loaded, so that several cameras attached at
+        // the same time wait for one load instead of loading the same model in parallel.
+        const std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) {
+            Entry newEntry;
+            newEntry.session = loadSession(resolvedModelPath, options);
+            it = m_entries.emplace(key, std::move(newEntry)).first;
+        }
+
+        Entry &entry = it->second;
+        ++entry.handleCount;
+
+        // The deleter keeps the registry alive, so the Env outlives every session handed out.
+        return std::shared_ptr<ModelSession>(
+                entry.session.get(),
+                [registry = shared_from_this(), key](ModelSession * /*session*/) {
+                    registry->release(key);
+                });
+    }
+
+    void ModelRegistry::setIdleTimeout(std::chrono::seconds idleTimeout) {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_idleTimeout = idleTimeout;
+        }
+        m_condition.notify_all();
+    }
+
+    std::filesystem::path ModelRegistry::resolveModelPath(
+            const std::filesystem::path &modelPath,
+            const ModelOptions &options) {
+        if (!options.preferInt8)
+            return modelPath;
+
+        std::filesystem::path int8ModelPath = modelPath;
+        int8ModelPath.replace_extension(".int8" + modelPath.extension().u8string());
+
+        std::error_code errorCode;
+        if (std::filesystem::is_regular_file(int8ModelPath, errorCode))
+            return int8ModelPath;
+
+        std::cout << "INT8 model " << int8ModelPath.u8string() << " not found, using "
+                  << modelPath.u8string() << std::endl;
+        return modelPath;
+    }
+
+    ModelRegistry::Stats ModelRegistry::stats() const {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+
+        Stats result;
+        result.sessionCount = m_entries.size();
+        for (const auto &[key, entry]: m_entries) {
+            result.handleCount += (size_t) entry.handleCount;
+
+            std::error_code errorCode;
+            const uintmax_t fileSize = std::filesystem::file_size(entry.session->modelPath, errorCode);
+            if (!errorCode)
+                result.modelFileBytes += fileSize;
+        }
+        return result;
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+    std::shared_ptr<ModelSession> ModelRegistry::loadSession(
+            const std::filesystem::path &modelPath,
+            const ModelOptions &options) {
+        Ort::SessionOptions sessionOptions;
+
+        // Set number of intra-op threads for parallelism
+        const int intraOpNumThreads = options.intraOpNumThreads > 0
+                                      ? options.intraOpNumThreads
+                                      : std::min(6, static_cast<int>(std::thread::hardware_concurrency()));
+        sessionOptions.SetIntraOpNumThreads(intraOpNumThreads);
+        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+
+        // Use the arena allocator registered in the Env instead of a per-session one.
+        sessionOptions.AddConfigEntry("session.use_env_allocators", "1");
+
+        // Retrieve available execution providers (e.g., CPU, CUDA)
+        std::vector<std::string> availableProviders = Ort::GetAvailableProviders();
+        auto cudaAvailable = std::find(availableProviders.begin(), availableProviders.end(),
+                                       "CUDAExecutionProvider");
+        OrtCUDAProviderOptions cudaOption;
+
+        // Configure session options based on whether GPU is to be used and available
+        if (options.useGpu && cudaAvailable != availableProviders.end()) {
+            std::cout << "Inference device: GPU" << std::endl;
+            sessionOptions.AppendExecutionProvider_CUDA(cudaOption); // Append CUDA execution provider
+        } else {
+            if (options.useGpu) {
+                std::cout << "GPU is not supported by your ONNXRuntime build. Fallback to CPU." << std::endl;
+            }
+            std::cout << "Inference device: CPU" << std::endl;
+        }
+
+        auto result = std::make_shared<ModelSession>();
+        result->modelPath = modelPath;
+
+        // Load the ONNX model into the session
+        std::cout << "Loading model: " << modelPath.u8string() << std::endl;
+#ifdef _WIN32
+        const std::wstring modelPathStr = modelPath.wstring();
+#else
+        const std::string modelPathStr = modelPath.u8string();
+#endif
+        result->session = Ort::Session(m_env, modelPathStr.c_str(), sessionOptions, m_prepackedWeights);
+
+        Ort::AllocatorWithDefaultOptions allocator;
+
+        // Retrieve input tensor shape information
+        Ort::TypeInfo inputTypeInfo = result->session.GetInputTypeInfo(0);
+        std::vector<int64_t> inputTensorShapeVec = inputTypeInfo.GetTensorTypeAndShapeInfo().GetShape();
+        result->isDynamicInputShape = (inputTensorShapeVec.size() >= 4) && (inputTensorShapeVec[2] == -1 &&
+                                                                            inputTensorShapeVec[3] ==
+                                                                            -1); // Check for dynamic dimensions
+        result->isDynamicBatchSize = !inputTensorShapeVec.empty() && inputTensorShapeVec[0] == -1;
+
+        // Allocate and store input node names
+        auto input_name = result->session.GetInputNameAllocated(0, allocator);
+        result->inputNodeNameAllocatedStrings.push_back(std::move(input_name));
+        result->inputNames.push_back(result->inputNodeNameAllocatedStrings.back().get());
+
+        // Allocate and store output node names
+        auto output_name = result->session.GetOutputNameAllocated(0, allocator);
+        result->outputNodeNameAllocatedStrings.push_back(std::move(output_name));
+        result->outputNames.push_back(result->outputNodeNameAllocatedStrings.back().get());
+
+        // Set the expected input image shape based on the model's input tensor
+        if (inputTensorShapeVec.size() >= 4) {
+            result->inputImageShape = cv::Size(static_cast<int>(inputTensorShapeVec[3]),
+                                               static_cast<int>(inputTensorShapeVec[2]));
+        } else {
+            throw ObjectDetectorInitializationError("Invalid input tensor shape.");
+        }
+
+        // Get the number of input and output nodes
+        result->numInputNodes = result->session.GetInputCount();
+        result->numOutputNodes = result->session.GetOutputCount();
+        std::cout << "Model loaded successfully with " << result->numInputNodes << " input nodes and "
+                  << result->numOutputNodes
+                  << " output nodes." << std::endl;
+
+        return result;
+    }
+
+    void ModelRegistry::release(const std::string &key) {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            const auto it = m_entries.find(key);
+            if (it == m_entries.end())
+                return;
+
+            Entry &entry = it->second;
+            if (--entry.handleCount == 0)
+                entry.idleSince = Clock::now();
+        }
+        m_condition.notify_all();
+    }
+
+/**
+ * Destroy the sessions which have had no users for longer than the idle timeout. Must be called
+ * with m_mutex locked.
+ */
+    void ModelRegistry::evictIdleSessions() {
+        const Clock::time_point now = Clock::now();
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            const Entry &entry = it->second;
+            if (entry.handleCount == 0 && now - entry.idleSince >= m_idleTimeout) {
+                std::cout << "Unloading idle model: " << entry.session->modelPath.u8string() << std::endl;
+                it = m_entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+}
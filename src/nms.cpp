@@ -0,0 +1,193 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "nms.h"
+
+#include <algorithm>
+
+#include "simd.h"
+
+namespace nx_meta_plugin {
+
+    void NmsBoxes::clear() {
+        x1.clear();
+        y1.clear();
+        x2.clear();
+        y2.clear();
+        scores.clear();
+        classIds.clear();
+    }
+
+    void NmsBoxes::reserve(size_t capacity) {
+        x1.reserve(capacity);
+        y1.reserve(capacity);
+        x2.reserve(capacity);
+        y2.reserve(capacity);
+        scores.reserve(capacity);
+        classIds.reserve(capacity);
+    }
+
+    void NmsBoxes::push_back(float left, float top, float right, float bottom, float score, int32_t classId) {
+        x1.push_back(left);
+        y1.push_back(top);
+        x2.push_back(right);
+        y2.push_back(bottom);
+        scores.push_back(score);
+        classIds.push_back(classId);
+    }
+
+/**
+ * Mark the boxes [begin, count) of the bucket whose IoU with box i is greater than iouThreshold.
+ * IoU > t is tested as intersection > t * union, which needs no division.
+ */
+    static void suppressOverlapping(
+            const NmsBoxes &bucket,
+            const float *areas,
+            size_t i,
+            size_t begin,
+            size_t count,
+            float iouThreshold,
+            int32_t *suppressed) {
+        const float left = bucket.x1[i];
+        const float top = bucket.y1[i];
+        const float right = bucket.x2[i];
+        const float bottom = bucket.y2[i];
+        const float area = areas[i];
+
+        size_t j = begin;
+#if defined(NX_PLUGIN_SIMD_AVX2)
+        const __m256 lefts = _mm256_set1_ps(left);
+        const __m256 tops = _mm256_set1_ps(top);
+        const __m256 rights = _mm256_set1_ps(right);
+        const __m256 bottoms = _mm256_set1_ps(bottom);
+        const __m256 areaVector = _mm256_set1_ps(area);
+        const __m256 threshold = _mm256_set1_ps(iouThreshold);
+        const __m256 zero = _mm256_setzero_ps();
+        for (; j + 8 <= count; j += 8) {
+            const __m256 width = _mm256_max_ps(zero, _mm256_sub_ps(
+                    _mm256_min_ps(rights, _mm256_loadu_ps(&bucket.x2[j])),
+                    _mm256_max_ps(lefts, _mm256_loadu_ps(&bucket.x1[j]))));
+            const __m256 height = _mm256_max_ps(zero, _mm256_sub_ps(
+                    _mm256_min_ps(bottoms, _mm256_loadu_ps(&bucket.y2[j])),
+                    _mm256_max_ps(tops, _mm256_loadu_ps(&bucket.y1[j]))));
+            const __m256 intersection = _mm256_mul_ps(width, height);
+            const __m256 unionArea = _mm256_sub_ps(_mm256_add_ps(areaVector, _mm256_loadu_ps(areas + j)), intersection);
+            const __m256 overlapping = _mm256_cmp_ps(intersection, _mm256_mul_ps(threshold, unionArea), _CMP_GT_OQ);
+
+            __m256i *const flags = reinterpret_cast<__m256i *>(suppressed + j);
+            _mm256_storeu_si256(flags, _mm256_or_si256(_mm256_loadu_si256(flags), _mm256_castps_si256(overlapping)));
+        }
+#elif defined(NX_PLUGIN_SIMD_SSE2)
+        const __m128 lefts = _mm_set1_ps(left);
+        const __m128 tops = _mm_set1_ps(top);
+        const __m128 rights = _mm_set1_ps(right);
+        const __m128 bottoms = _mm_set1_ps(bottom);
+        const __m128 areaVector = _mm_set1_ps(area);
+        const __m128 threshold = _mm_set1_ps(iouThreshold);
+        const __m128 zero = _mm_setzero_ps();
+        for (; j + 4 <= count; j += 4) {
+            const __m128 width = _mm_max_ps(zero, _mm_sub_ps(
+                    _mm_min_ps(rights, _mm_loadu_ps(&bucket.x2[j])),
+                    _mm_max_ps(lefts, _mm_loadu_ps(&bucket.x1[j]))));
+            const __m128 height = _mm_max_ps(zero, _mm_sub_ps(
+                    _mm_min_ps(bottoms, _mm_loadu_ps(&bucket.y2[j])),
+                    _mm_max_ps(tops, _mm_loadu_ps(&bucket.y1[j]))));
+            const __m128 intersection = _mm_mul_ps(width, height);
+            const __m128 unionArea = _mm_sub_ps(_mm_add_ps(areaVector, _mm_loadu_ps(areas + j)), intersection);
+            const __m128 overlapping = _mm_cmpgt_ps(intersection, _mm_mul_ps(threshold, unionArea));
+
+            __m128i *const flags = reinterpret_cast<__m128i *>(suppressed + j);
+            _mm_storeu_si128(flags, _mm_or_si128(_mm_loadu_si128(flags), _mm_castps_si128(overlapping)));
+        }
+#endif
+        for (; j < count; ++j) {
+            const float width = std::max(0.0f, std::min(right, bucket.x2[j]) - std::max(left, bucket.x1[j]));
+            const float height = std::max(0.0f, std::min(bottom, bucket.y2[j]) - std::max(top, bucket.y1[j]));
+            const float intersection = width * height;
+            if (intersection > iouThreshold * (area + areas[j] - intersection))
+                suppressed[j] = -1;
+        }
+    }
+
+    NmsEngine::NmsEngine(const NmsOptions &options) :
+            m_options(options) {
+    }
+
+    const std::vector<int32_t> &NmsEngine::run(const NmsBoxes &boxes, float iouThreshold) {
+        m_kept.clear();
+        const size_t numBoxes = boxes.size();
+        if (numBoxes == 0)
+            return m_kept;
+
+        // Group the box indices by class with a counting sort.
+        const int32_t maxClassId = *std::max_element(boxes.classIds.begin(), boxes.classIds.end());
+        m_bucketStarts.assign((size_t) maxClassId + 2, 0);
+        for (const int32_t classId: boxes.classIds)
+            ++m_bucketStarts[(size_t) classId + 1];
+        for (size_t c = 1; c < m_bucketStarts.size(); ++c)
+            m_bucketStarts[c] += m_bucketStarts[c - 1];
+
+        m_order.resize(numBoxes);
+        m_suppressed.assign(m_bucketStarts.begin(), m_bucketStarts.end() - 1); //< Insert positions.
+        for (size_t i = 0; i < numBoxes; ++i)
+            m_order[(size_t) m_suppressed[(size_t) boxes.classIds[i]]++] = (int32_t) i;
+
+        for (size_t c = 0; c + 1 < m_bucketStarts.size(); ++c) {
+            if (m_bucketStarts[c] != m_bucketStarts[c + 1]) {
+                suppressBucket(boxes, m_order.begin() + (ptrdiff_t) m_bucketStarts[c],
+                               m_order.begin() + (ptrdiff_t) m_bucketStarts[c + 1], iouThreshold);
+            }
+        }
+
+        // Merge the classes.
+        std::sort(m_kept.begin(), m_kept.end(),
+                  [&boxes](int32_t a, int32_t b) { return boxes.scores[(size_t) a] > boxes.scores[(size_t) b]; });
+        if (m_options.maxDetections > 0 && m_kept.size() > m_options.maxDetections)
+            m_kept.resize(m_options.maxDetections);
+        return m_kept;
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+    void NmsEngine::suppressBucket(
+            const NmsBoxes &boxes,
+            std::vector<int32_t>::iterator begin,
+            std::vector<int32_t>::iterator end,
+            float iouThreshold) {
+        const auto byScore =
+                [&boxes](int32_t a, int32_t b) {
+                    return boxes.scores[(size_t) a] > boxes.scores[(size_t) b];
+                };
+
+        // Only the topK best boxes of the class take part; select them before sorting.
+        if (m_options.topK > 0 && (size_t) (end - begin) > m_options.topK) {
+            std::nth_element(begin, begin + (ptrdiff_t) m_options.topK, end, byScore);
+            end = begin + (ptrdiff_t) m_options.topK;
+        }
+        std::sort(begin, end, byScore);
+
+        // Gather the bucket into contiguous arrays for the SIMD IoU.
+        const size_t count = (size_t) (end - begin);
+        m_bucket.clear();
+        m_areas.clear();
+        for (auto it = begin; it != end; ++it) {
+            const size_t i = (size_t) *it;
+            m_bucket.push_back(boxes.x1[i], boxes.y1[i], boxes.x2[i], boxes.y2[i], boxes.scores[i], boxes.classIds[i]);
+            m_areas.push_back((boxes.x2[i] - boxes.x1[i]) * (boxes.y2[i] - boxes.y1[i]));
+        }
+        m_suppressed.assign(count, 0);
+
+        size_t keptCount = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (m_suppressed[i])
+                continue;
+
+            m_kept.push_back(begin[(ptrdiff_t) i]);
+            if (++keptCount == m_options.maxDetections)
+                break;
+
+            suppressOverlapping(m_bucket, m_areas.data(), i, i + 1, count, iouThreshold, m_suppressed.data());
+        }
+    }
+
+}
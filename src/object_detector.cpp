@@ -5,6 +5,7 @@
 #include <opencv2/core.hpp>
 
 #include "exceptions.h"
+#include "geometry.h"
 
 namespace nx_meta_plugin {
     using namespace std::string_literals;
@@ -49,7 +50,7 @@ namespace nx_meta_plugin {
         m_terminated = true;
     }
 
-    DetectionList ObjectDetector::run(const Frame &frame) {
+    DetectionBatch ObjectDetector::run(const Frame &frame) {
         if (isTerminated())
             throw ObjectDetectorIsTerminatedError("Detection error: object detector is terminated.");
 
@@ -87,9 +88,15 @@ namespace nx_meta_plugin {
             throw ObjectDetectorInitializationError("Loading model: network is empty.");
     }
 
-    std::shared_ptr<Detection> convertRawDetectionToDetection(
+/**
+ * Append the detection of the given row of the raw network output to the batch, if it is
+ * confident and of a reported class.
+ */
+    void appendRawDetection(
             const Mat &rawDetections,
-            int detectionIndex) {
+            int detectionIndex,
+            const Frame &frame,
+            DetectionBatch *outDetections) {
         enum class OutputIndex {
             classIndex = 1,
             confidence = 2,
@@ -103,10 +110,9 @@ namespace nx_meta_plugin {
         const int &i = detectionIndex;
         const float confidence = rawDetections.at<float>(i, (int) OutputIndex::confidence);
         const auto classIndex = (int) (rawDetections.at<float>(i, (int) OutputIndex::classIndex));
-        const std::string classLabel = kClasses[(size_t) classIndex];
         const bool confidentDetection = confidence >= confidenceThreshold;
-        bool oneOfRequiredClasses = std::find(
-                kClassesToDetect.begin(), kClassesToDetect.end(), classLabel) != kClassesToDetect.end();
+        const bool oneOfRequiredClasses = kClassesToDetect.contains(classIndex)
+                                          && classIndex < (int) kClasses.size();
         if (confidentDetection && oneOfRequiredClasses) {
             const float xBottomLeft = rawDetections.at<float>(i, (int) OutputIndex::xBottomLeft);
             const float yBottomLeft = rawDetections.at<float>(i, (int) OutputIndex::yBottomLeft);
@@ -115,17 +121,18 @@ namespace nx_meta_plugin {
             const float width = xTopRight - xBottomLeft;
             const float height = yTopRight - yBottomLeft;
 
-            return std::make_shared<Detection>(Detection{
-                    /*boundingBox*/ nx::sdk::analytics::Rect(xBottomLeft, yBottomLeft, width, height),
-                                    classLabel,
-                                    confidence,
-                    /*trackId*/ nx::sdk::Uuid() //< Will be filled with real value in ObjectTracker.
-            });
+            // The network outputs boxes relative to the frame size.
+            outDetections->push_back(
+                    nxRectToCvRect(
+                            nx::sdk::analytics::Rect(xBottomLeft, yBottomLeft, width, height),
+                            frame.width,
+                            frame.height),
+                    classIndex,
+                    confidence);
         }
-        return nullptr;
     }
 
-    DetectionList ObjectDetector::runImpl(const Frame &frame) {
+    DetectionBatch ObjectDetector::runImpl(const Frame &frame) {
         if (isTerminated()) {
             throw ObjectDetectorIsTerminatedError(
                     "Object detection error: object detector is terminated.");
@@ -150,13 +157,10 @@ namespace nx_meta_plugin {
                 /*_type*/ CV_32F,
                 /*_s*/ rawDetections.ptr<float>());
 
-        DetectionList result;
+        DetectionBatch result;
 
-        for (int i = 0; i < detections.rows; ++i) {
-            const std::shared_ptr<Detection> detection = convertRawDetectionToDetection(detections, i);
-            if (detection)
-                result.push_back(detection);
-        }
+        for (int i = 0; i < detections.rows; ++i)
+            appendRawDetection(detections, i, frame, &result);
 
         return result;
     }
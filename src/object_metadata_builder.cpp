@@ -0,0 +1,116 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "object_metadata_builder.h"
+
+#include <nx/sdk/helpers/uuid_helper.h>
+
+#include "geometry.h"
+
+namespace nx_meta_plugin {
+
+    using namespace nx::sdk;
+    using namespace nx::sdk::analytics;
+
+//-------------------------------------------------------------------------------------------------
+// public
+
+    ObjectMetadataBuilder::ObjectMetadataBuilder() {
+        m_labelAttributes[0] = {
+                makePtr<Attribute>(IAttribute::Type::string, "Type", classificationLabel(kUnknownClassification)),
+                makePtr<Attribute>(IAttribute::Type::string, "nx.sys.color", kUnknownClassificationColor)};
+        for (size_t classId = 0; classId < kClassesToClassification.size(); ++classId) {
+            m_labelAttributes[classId + 1] = {
+                    makePtr<Attribute>(IAttribute::Type::string, "Type", kClassesToClassification[classId]),
+                    makePtr<Attribute>(IAttribute::Type::string, "nx.sys.color", kClassificationColors[classId])};
+        }
+    }
+
+    Ptr<ObjectMetadataPacket> ObjectMetadataBuilder::build(
+            const DetectionBatch &detections,
+            const Frame &frame) {
+        Ptr<ObjectMetadataPacket> objectMetadataPacket;
+        if (!detections.empty()) {
+            objectMetadataPacket = makePtr<ObjectMetadataPacket>();
+            for (size_t i = 0; i < detections.size(); ++i) {
+                // Only the detections of the reported classes are generated.
+                const int classId = detections.classIds[i];
+                if (classId < 0 || (size_t) classId >= kObjectTypes.size() || !kObjectTypes[(size_t) classId])
+                    continue;
+
+                const Ptr<ObjectMetadata> objectMetadata = this->objectMetadata(
+                        detections.trackIds[i], classId, detections.labels[i], frame.timestampUs);
+                objectMetadata->setBoundingBox(cvRectToNxRect(detections.boxes[i], frame.width, frame.height));
+                objectMetadata->setConfidence(detections.confidences[i]);
+                objectMetadataPacket->addItem(objectMetadata.get());
+            }
+            objectMetadataPacket->setTimestampUs(frame.timestampUs);
+        }
+
+        removeStale(frame.timestampUs);
+        return objectMetadataPacket;
+    }
+
+    void ObjectMetadataBuilder::clear() {
+        m_tracks.clear();
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+/**
+ * @return Metadata of the tracked object with everything but the box and the confidence: the one
+ *     of the previous frame if it can be reused, a new one otherwise.
+ */
+    Ptr<ObjectMetadata> ObjectMetadataBuilder::objectMetadata(
+            const Uuid &trackId,
+            int classId,
+            int label,
+            int64_t timestampUs) {
+        if (label < 0 || (size_t) label >= kClassesToClassification.size())
+            label = kUnknownClassification;
+
+        Track &track = m_tracks[trackId];
+        track.lastSeenUs = timestampUs;
+        if (!track.trackIdAttribute) {
+            track.trackIdAttribute = makePtr<Attribute>(
+                    IAttribute::Type::string, "TrackID", UuidHelper::toStdString(trackId));
+        }
+
+        // When the reference of the track is the only one left, the Server has released the
+        // packets with the object, and nobody else can take a new reference to it.
+        if (track.objectMetadata
+            && track.classId == classId
+            && track.label == label
+            && track.objectMetadata->refCountThreadUnsafe() == 1) {
+            return track.objectMetadata;
+        }
+
+        const auto objectMetadata = makePtr<ObjectMetadata>();
+        objectMetadata->setTypeId(kObjectTypes[(size_t) classId]);
+        objectMetadata->setTrackId(trackId);
+        if (classId == kPersonClassId) {
+            const LabelAttributes &attributes = m_labelAttributes[(size_t) (label + 1)];
+            if (label == kUnknownClassification)
+                objectMetadata->setSubtype(classificationLabel(label));
+            objectMetadata->addAttribute(attributes.type);
+            objectMetadata->addAttribute(track.trackIdAttribute);
+            objectMetadata->addAttribute(attributes.color);
+        }
+
+        track.objectMetadata = objectMetadata;
+        track.classId = classId;
+        track.label = label;
+        return objectMetadata;
+    }
+
+    void ObjectMetadataBuilder::removeStale(int64_t timestampUs) {
+        for (auto it = m_tracks.begin(); it != m_tracks.end();) {
+            const int64_t idleUs = timestampUs - it->second.lastSeenUs;
+            if (idleUs >= kTrackLifetimeUs || idleUs < 0)
+                it = m_tracks.erase(it);
+            else
+                ++it;
+        }
+    }
+
+}
@@ -2,6 +2,8 @@
 
 #include "object_tracker.h"
 
+#include <cmath>
+
 #include <opencv2/core/core.hpp>
 
 #include "exceptions.h"
@@ -16,43 +18,20 @@ namespace nx_meta_plugin {
     using namespace nx::sdk;
     using namespace nx::sdk::analytics;
 
-/**
- * This function implementation is based on the sample from opencv_contrib repository:
- * https://github.com/opencv/opencv_contrib/blob/0a2179b328/modules/tracking/samples/tracking_by_matching.cpp
- */
-    cv::Ptr<ITrackerByMatching> createTrackerByMatchingWithFastDescriptor() {
-        TrackerParams params;
-
-        // Real forget delay will be `params.forget_delay * kDetectionFramePeriod`.
-        params.forget_delay = 75;
-
-        cv::Ptr<ITrackerByMatching> tracker = createTrackerByMatching(params);
-
-        static const Size kDescriptorFastSize(16, 32);
-        std::shared_ptr<IImageDescriptor> descriptorFast =
-                std::make_shared<ResizedImageDescriptor>(
-                        kDescriptorFastSize, InterpolationFlags::INTER_LINEAR);
-        std::shared_ptr<IDescriptorDistance> distanceFast =
-                std::make_shared<MatchTemplateDistance>();
-
-        tracker->setDescriptorFast(descriptorFast);
-        tracker->setDistanceFast(distanceFast);
-
-        return tracker;
-    }
-
 //-------------------------------------------------------------------------------------------------
 // public
 
-    ObjectTracker::ObjectTracker() :
-            m_tracker(createTrackerByMatchingWithFastDescriptor()) {
+    ObjectTracker::ObjectTracker(TrackerType type) :
+            m_type(type),
+            m_backend(createTrackerBackend(type)) {
     }
 
-    DetectionList ObjectTracker::run(
+    void ObjectTracker::run(
             const Frame &frame,
-            const DetectionList &detections) {
+            const DetectionBatch &detections,
+            DetectionBatch *outTrackedDetections) {
         try {
-            return runImpl(frame, detections);
+            runImpl(frame, detections, outTrackedDetections);
         }
         catch (const cv::Exception &e) {
             throw ObjectTrackingError(cvExceptionToStdString(e));
@@ -62,45 +41,60 @@ namespace nx_meta_plugin {
         }
     }
 
+    void ObjectTracker::setDetectionRate(double rateHz) {
+        m_forgetDelayFrames = std::max<size_t>(
+                1, (size_t) std::lround(rateHz * std::chrono::duration<double>(kForgetDelay).count()));
+        m_backend->setForgetDelay(m_forgetDelayFrames);
+    }
+
+    bool ObjectTracker::hasActiveTracks() const {
+        return m_backend->hasActiveTracks();
+    }
+
+    void ObjectTracker::trackMotions(std::vector<TrackMotion> *outTrackMotions) const {
+        m_backend->trackMotions(outTrackMotions);
+    }
+
 //-------------------------------------------------------------------------------------------------
 // private
 
-    DetectionList ObjectTracker::runImpl(
+    void ObjectTracker::runImpl(
             const Frame &frame,
-            const DetectionList &detections) {
-        // Unfortunately the OpenCV tbm module does not support preserving classLabel during tracking.
-        // See issue: https://github.com/opencv/opencv_contrib/issues/2298
-        // Therefore, we save information about classLabels in the map from unique id of the detection
-        // (bounding box + timestamp) to classLabel.
-        std::map<const CompositeDetectionId, std::string> classLabels;
-
-        TrackedObjects detectionsToTrack = convertDetectionsToTrackedObjects(
-                /*frame*/ frame,
-                /*detections*/ detections,
-                /*classLabels*/ &classLabels);
+            const DetectionBatch &detections,
+            DetectionBatch *outTrackedDetections) {
+        // The tracker backends know nothing about the class labels (see issue
+        // https://github.com/opencv/opencv_contrib/issues/2298 for cv::tbm), but they keep the
+        // index of the detection in every tracked object, so the tracked detections are copied
+        // from the batch, with the track ids assigned.
+        convertDetectionsToTrackedObjects(detections, &m_detectionsToTrack);
 
         // Perform tracking and extract tracked detections.
-        m_tracker->process(frame.cvMat, detectionsToTrack, (uint64_t) frame.timestampUs);
-        const TrackedObjects trackedDetections = m_tracker->trackedDetections();
-
-        DetectionList result = convertTrackedObjectsToDetections(
-                /*frame*/ frame,
-                /*trackedDetections*/ trackedDetections,
-                /*classLabels*/ classLabels,
-                /*idMapper*/ m_idMapper.get());
+        const TrackedObjects trackedDetections =
+                m_backend->process(frame.cvMat, m_detectionsToTrack, frame.timestampUs);
+
+        m_idMapper->nextGeneration();
+        outTrackedDetections->clear();
+        outTrackedDetections->reserve(trackedDetections.size());
+        for (const TrackedObject &trackedDetection: trackedDetections) {
+            const int index = findDetectionIndex(trackedDetection, m_detectionsToTrack);
+            if (index < 0)
+                continue;
+            const size_t i = (size_t) index;
+            outTrackedDetections->push_back(
+                    detections.boxes[i],
+                    detections.classIds[i],
+                    detections.confidences[i],
+                    m_idMapper->get(trackedDetection.object_id));
+        }
 
         cleanupIds();
-
-        return result;
     }
 
 /**
- * Cleanup ids of the objects that belong to the forgotten tracks.
+ * Cleanup ids of the objects that belong to the forgotten tracks: a track not seen for longer than
+ * the forget delay is forgotten by the backend as well.
  */
     void ObjectTracker::cleanupIds() {
-        std::set<int64_t> validIds;
-        for (const auto &track: m_tracker->tracks())
-            validIds.insert(track.second.first_object.object_id);
-        m_idMapper->removeAllExcept(validIds);
+        m_idMapper->removeOlderThan(m_forgetDelayFrames + 1);
     }
 }
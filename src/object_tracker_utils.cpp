@@ -2,8 +2,6 @@
 
 #include "object_tracker_utils.h"
 
-#include "geometry.h"
-
 namespace nx_meta_plugin {
 
     using namespace cv;
@@ -12,96 +10,85 @@ namespace nx_meta_plugin {
     using namespace nx::sdk;
 
     Uuid IdMapper::get(int64_t id) {
-        const auto it = m_map.find(id);
-        if (it == m_map.end()) {
-            Uuid result = UuidHelper::randomUuid();
-            m_map[id] = result;
-            return result;
+        size_t index = findSlot(id);
+        if (!m_slots[index].used) {
+            if (2 * (m_size + 1) > m_slots.size()) {
+                rehash(2 * m_slots.size(), m_generation);
+                index = findSlot(id);
+            }
+            m_slots[index].id = id;
+            m_slots[index].uuid = UuidHelper::randomUuid();
+            m_slots[index].used = true;
+            ++m_size;
         }
-        return it->second;
+        m_slots[index].generation = m_generation;
+        return m_slots[index].uuid;
     }
 
-    void IdMapper::removeAllExcept(const std::set<int64_t> &idsToKeep) {
-        for (auto it = m_map.begin(); it != m_map.end();) {
-            if (idsToKeep.find(it->first) == idsToKeep.end())
-                it = m_map.erase(it);
-            else
-                ++it;
+    void IdMapper::removeOlderThan(uint64_t maxAge) {
+        for (const Slot &slot: m_slots) {
+            if (slot.used && m_generation - slot.generation > maxAge) {
+                rehash(m_slots.size(), maxAge);
+                return;
+            }
         }
     }
 
 /**
- * Convert detections from the plugin format to the format of opencv::detail::tracking::tbm, preserving classLabels.
+ * @return Index of the slot of the id, or of the free slot it goes into.
  */
-    TrackedObjects convertDetectionsToTrackedObjects(
-            const Frame &frame,
-            const DetectionList &detections,
-            ClassLabelMap *inOutClassLabels) {
-        TrackedObjects result;
-
-        for (const std::shared_ptr<Detection> &detection: detections) {
-            const cv::Rect cvRect = nxRectToCvRect(
-                    detection->boundingBox,
-                    frame.width,
-                    frame.height);
-
-            inOutClassLabels->insert(std::make_pair(CompositeDetectionId{
-                                                            frame.index,
-                                                            cvRect},
-                                                    detection->classLabel));
-
-            result.push_back(TrackedObject(
-                    cvRect,
-                    detection->confidence,
-                    (int) frame.index,
-                    /*object_id*/ -1)); //< Placeholder, to be filled in ObjectTracker::process().
+    size_t IdMapper::findSlot(int64_t id) const {
+        const size_t mask = m_slots.size() - 1;
+        uint64_t hash = (uint64_t) id * 0x9E3779B97F4A7C15ull; //< Fibonacci hashing.
+        hash ^= hash >> 32;
+        for (size_t index = (size_t) hash & mask;; index = (index + 1) & mask) {
+            const Slot &slot = m_slots[index];
+            if (!slot.used || slot.id == id)
+                return index;
         }
-
-        return result;
     }
 
 /**
- * Convert detection from tbm format to our format, restoring the classLabels.
+ * Move the ids used in the last maxAge generations into a table of the given capacity. Linear
+ * probing cannot simply empty a slot, so evicting rebuilds the table this way as well.
  */
-    std::shared_ptr<Detection> convertTrackedObjectToDetection(
-            const Frame &frame,
-            const TrackedObject &trackedDetection,
-            const std::string &classLabel,
-            IdMapper *idMapper) {
-        return std::make_shared<Detection>(Detection{
-                /*boundingBox*/ cvRectToNxRect(trackedDetection.rect, frame.width, frame.height),
-                                classLabel,
-                                (float) trackedDetection.confidence,
-                /*trackId*/ idMapper->get(trackedDetection.object_id)});
+    void IdMapper::rehash(size_t capacity, uint64_t maxAge) {
+        m_rehashedSlots.assign(capacity, Slot());
+        m_rehashedSlots.swap(m_slots);
+        m_size = 0;
+        for (const Slot &slot: m_rehashedSlots) {
+            if (!slot.used || m_generation - slot.generation > maxAge)
+                continue;
+            m_slots[findSlot(slot.id)] = slot;
+            ++m_size;
+        }
     }
 
-/**
- * Convert detections from opencv::detail::tracking::tbm format to the plugin format, restoring classLabels.
- */
-    DetectionList convertTrackedObjectsToDetections(
-            const Frame &frame,
-            const TrackedObjects &trackedDetections,
-            const ClassLabelMap &classLabels,
-            IdMapper *idMapper) {
-        DetectionList result;
-        for (const cv::tbm::TrackedObject &trackedDetection: trackedDetections) {
-            const std::string classLabel = classLabels.at({
-                                                                  frame.index,
-                                                                  trackedDetection.rect});
-            result.push_back(convertTrackedObjectToDetection(
-                    frame,
-                    trackedDetection,
-                    classLabel,
-                    idMapper));
+    void convertDetectionsToTrackedObjects(
+            const DetectionBatch &detections,
+            TrackedObjects *outTrackedObjects) {
+        outTrackedObjects->clear();
+        for (size_t i = 0; i < detections.size(); ++i) {
+            outTrackedObjects->push_back(TrackedObject(
+                    detections.boxes[i],
+                    detections.confidences[i],
+                    /*frame_idx*/ (int) i,
+                    /*object_id*/ -1)); //< Placeholder, to be filled by the tracker backend.
         }
-
-        return result;
     }
 
-    DetectionList extractDetectionList(const DetectionInternalList &detectionsInternal) {
-        DetectionList result;
-        for (const std::shared_ptr<DetectionInternal> &detection: detectionsInternal)
-            result.push_back(detection->detection);
-        return result;
+    int findDetectionIndex(const TrackedObject &trackedObject, const TrackedObjects &trackedDetections) {
+        const size_t index = (size_t) trackedObject.frame_idx;
+        if (trackedObject.frame_idx >= 0 && index < trackedDetections.size()
+            && trackedDetections[index].rect == trackedObject.rect) {
+            return (int) index;
+        }
+
+        // The backends keep frame_idx, so this is only a safety net.
+        for (size_t i = 0; i < trackedDetections.size(); ++i) {
+            if (trackedDetections[i].rect == trackedObject.rect)
+                return (int) i;
+        }
+        return -1;
     }
-}
\ No newline at end of file
+}
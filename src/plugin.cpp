@@ -3,6 +3,7 @@
 #include "plugin.h"
 
 #include "engine.h"
+#include "settings.h"
 
 namespace nx_meta_plugin {
     using namespace nx::sdk;
@@ -26,6 +27,7 @@ namespace nx_meta_plugin {
  * - description: Description of the plugin in a few sentences.
  * - version: Version of the plugin.
  * - vendor: Plugin creator (person or company) name.
+ * - engineSettingsModel: Settings of the Engine, shared by all cameras.
  */
     std::string Plugin::manifestString() const
     {
@@ -37,7 +39,58 @@ namespace nx_meta_plugin {
                                         "This plugin is for object detection and tracking. It's based on OpenCV."
                                         R"json(",
     "version": "1.0.27",
-    "vendor": "duydq"
+    "vendor": "duydq",
+    "engineSettingsModel": {
+        "type": "Settings",
+        "items": [
+            {
+                "type": "GroupBox",
+                "caption": "Models",
+                "items": [
+                    {
+                        "type": "SpinBox",
+                        "name": ")json" + kModelIdleTimeoutSetting + R"json(",
+                        "caption": "Unload unused models after (s)",
+                        "description": "Time a model stays loaded after the last camera using it is detached",
+                        "defaultValue": )json" + std::to_string(kDefaultModelIdleTimeoutS) + R"json(,
+                        "minValue": 0,
+                        "maxValue": 86400
+                    },
+                    {
+                        "type": "CheckBox",
+                        "name": ")json" + kPreferInt8ModelsSetting + R"json(",
+                        "caption": "Prefer INT8 models",
+                        "description": "Load <model>.int8.onnx instead of <model>.onnx when it exists; applies to cameras attached afterwards",
+                        "defaultValue": )json" + (kDefaultPreferInt8Models ? "true" : "false") + R"json(
+                    }
+                ]
+            },
+            {
+                "type": "GroupBox",
+                "caption": "Detection batching",
+                "items": [
+                    {
+                        "type": "SpinBox",
+                        "name": ")json" + kDetectionMaxBatchSizeSetting + R"json(",
+                        "caption": "Maximum batch size",
+                        "description": "Frames of different cameras detected in one inference call; 1 disables batching",
+                        "defaultValue": )json" + std::to_string(kDefaultDetectionMaxBatchSize) + R"json(,
+                        "minValue": 1,
+                        "maxValue": 64
+                    },
+                    {
+                        "type": "SpinBox",
+                        "name": ")json" + kDetectionMaxWaitMsSetting + R"json(",
+                        "caption": "Maximum wait for a batch (ms)",
+                        "description": "Longest time a frame waits for frames of other cameras to join its batch",
+                        "defaultValue": )json" + std::to_string(kDefaultDetectionMaxWaitMs) + R"json(,
+                        "minValue": 0,
+                        "maxValue": 1000
+                    }
+                ]
+            }
+        ]
+    }
 }
 )json";
     }
@@ -0,0 +1,256 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "preprocessing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "simd.h"
+
+namespace nx_meta_plugin {
+
+    /** Value of the letterbox padding, the same as the one used by letterBox(). */
+    static constexpr float kPadValue = 114.0f / 255.0f;
+
+/**
+ * Compute the bilinear interpolation coefficients the same way cv::resize() does for INTER_LINEAR:
+ * pixel centers are aligned, and the coordinates outside the source are clamped to its border.
+ */
+    static void computeLinearCoefficients(
+            int sourceLength,
+            int resizedLength,
+            int32_t elementSize,
+            std::vector<int32_t> *outOffsets,
+            std::vector<float> *outWeights) {
+        const double scale = (double) sourceLength / resizedLength;
+        const int maxIndex = std::max(0, sourceLength - 2);
+
+        outOffsets->resize((size_t) resizedLength);
+        outWeights->resize((size_t) resizedLength);
+        for (int i = 0; i < resizedLength; ++i) {
+            const double sourceCoordinate = (i + 0.5) * scale - 0.5;
+            int index = (int) std::floor(sourceCoordinate);
+            float weight = (float) (sourceCoordinate - index);
+            if (index < 0) {
+                index = 0;
+                weight = 0;
+            } else if (index > maxIndex) {
+                index = maxIndex;
+                weight = sourceLength > 1 ? 1.0f : 0.0f;
+            }
+            (*outOffsets)[(size_t) i] = index * elementSize;
+            (*outWeights)[(size_t) i] = weight;
+        }
+    }
+
+    LetterboxGeometry makeLetterboxGeometry(
+            const cv::Size &sourceSize,
+            const cv::Size &targetSize,
+            bool autoPad,
+            int stride) {
+        if (sourceSize.width <= 0 || sourceSize.height <= 0 || targetSize.width <= 0 || targetSize.height <= 0)
+            throw std::invalid_argument("Letterbox: invalid image or model input size.");
+
+        LetterboxGeometry result;
+        result.sourceSize = sourceSize;
+
+        // Same arithmetic as in letterBox(), so that the boxes are scaled back identically.
+        const float ratio = std::min((float) targetSize.height / sourceSize.height,
+                                     (float) targetSize.width / sourceSize.width);
+        result.resizedSize = cv::Size(
+                std::max(1, (int) std::round(sourceSize.width * ratio)),
+                std::max(1, (int) std::round(sourceSize.height * ratio)));
+
+        int dw = targetSize.width - result.resizedSize.width;
+        int dh = targetSize.height - result.resizedSize.height;
+        if (autoPad) {
+            dw = (dw % stride) / 2;
+            dh = (dh % stride) / 2;
+        }
+        result.padLeft = dw / 2;
+        result.padTop = dh / 2;
+        result.outputSize = cv::Size(result.resizedSize.width + dw, result.resizedSize.height + dh);
+
+        computeLinearCoefficients(sourceSize.width, result.resizedSize.width, /*elementSize*/ 3,
+                                  &result.sourceByteX, &result.weightX);
+        computeLinearCoefficients(sourceSize.height, result.resizedSize.height, /*elementSize*/ 1,
+                                  &result.sourceY, &result.weightY);
+        return result;
+    }
+
+/**
+ * out[i] = top[i] * topWeight + bottom[i] * bottomWeight.
+ */
+    static void blendRows(
+            const float *top,
+            const float *bottom,
+            float topWeight,
+            float bottomWeight,
+            float *out,
+            int count) {
+        int i = 0;
+#if defined(NX_PLUGIN_SIMD_AVX2)
+        const __m256 topWeights = _mm256_set1_ps(topWeight);
+        const __m256 bottomWeights = _mm256_set1_ps(bottomWeight);
+        for (; i + 8 <= count; i += 8) {
+            const __m256 value = _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_loadu_ps(top + i), topWeights),
+                    _mm256_mul_ps(_mm256_loadu_ps(bottom + i), bottomWeights));
+            _mm256_storeu_ps(out + i, value);
+        }
+#elif defined(NX_PLUGIN_SIMD_SSE2)
+        const __m128 topWeights = _mm_set1_ps(topWeight);
+        const __m128 bottomWeights = _mm_set1_ps(bottomWeight);
+        for (; i + 4 <= count; i += 4) {
+            const __m128 value = _mm_add_ps(
+                    _mm_mul_ps(_mm_loadu_ps(top + i), topWeights),
+                    _mm_mul_ps(_mm_loadu_ps(bottom + i), bottomWeights));
+            _mm_storeu_ps(out + i, value);
+        }
+#endif
+        for (; i < count; ++i)
+            out[i] = top[i] * topWeight + bottom[i] * bottomWeight;
+    }
+
+    const LetterboxGeometry &LetterboxPreprocessor::geometry(
+            const cv::Size &sourceSize,
+            const cv::Size &targetSize,
+            bool autoPad,
+            int stride) {
+        const std::array<int, 6> key = {
+                sourceSize.width, sourceSize.height, targetSize.width, targetSize.height, autoPad ? 1 : 0, stride};
+
+        const auto it = m_geometries.find(key);
+        if (it != m_geometries.end())
+            return it->second;
+
+        if (m_geometries.size() >= kMaxCachedGeometries)
+            m_geometries.clear();
+        return m_geometries.emplace(key, makeLetterboxGeometry(sourceSize, targetSize, autoPad, stride))
+                .first->second;
+    }
+
+    void LetterboxPreprocessor::run(
+            const cv::Mat &image,
+            const LetterboxGeometry &geometry,
+            bool swapRB,
+            float *outTensor) {
+        if (image.type() != CV_8UC3)
+            throw std::invalid_argument("Letterbox: the image must be CV_8UC3.");
+        if (image.cols != geometry.sourceSize.width || image.rows != geometry.sourceSize.height)
+            throw std::invalid_argument("Letterbox: the image does not match the geometry.");
+
+        run(image.ptr<uint8_t>(0), image.step, geometry, swapRB, outTensor);
+    }
+
+    void LetterboxPreprocessor::run(
+            const uint8_t *image,
+            size_t step,
+            const LetterboxGeometry &geometry,
+            bool swapRB,
+            float *outTensor) {
+        const int outputWidth = geometry.outputSize.width;
+        const int resizedWidth = geometry.resizedSize.width;
+        const int sourceHeight = geometry.sourceSize.height;
+        const size_t planeSize = (size_t) geometry.outputSize.area();
+        const size_t rowSize = 3 * (size_t) resizedWidth;
+
+        m_rows.resize(2 * rowSize);
+        m_rowIndices = {-1, -1};
+        float *const rows[2] = {m_rows.data(), m_rows.data() + rowSize};
+
+        const int padBottom = geometry.outputSize.height - geometry.resizedSize.height - geometry.padTop;
+        const int padRight = outputWidth - resizedWidth - geometry.padLeft;
+        for (int plane = 0; plane < 3; ++plane) {
+            float *const planeData = outTensor + plane * planeSize;
+            std::fill(planeData, planeData + (size_t) geometry.padTop * outputWidth, kPadValue);
+            std::fill(planeData + planeSize - (size_t) padBottom * outputWidth, planeData + planeSize, kPadValue);
+        }
+
+        for (int y = 0; y < geometry.resizedSize.height; ++y) {
+            const int top = geometry.sourceY[(size_t) y];
+            const int bottom = std::min(top + 1, sourceHeight - 1);
+
+            // Consecutive output rows mostly share source rows, so keep the last two interpolated.
+            const float *topRow = nullptr;
+            const float *bottomRow = nullptr;
+            for (int slot = 0; slot < 2; ++slot) {
+                if (m_rowIndices[(size_t) slot] == top)
+                    topRow = rows[slot];
+                if (m_rowIndices[(size_t) slot] == bottom)
+                    bottomRow = rows[slot];
+            }
+            if (!topRow) {
+                // Overwrite the slot which does not hold the bottom row.
+                const int slot = (bottomRow == rows[0]) ? 1 : 0;
+                interpolateRow(image + (size_t) top * step, geometry, rows[slot]);
+                m_rowIndices[(size_t) slot] = top;
+                topRow = rows[slot];
+            }
+            if (!bottomRow) {
+                const int slot = (topRow == rows[0]) ? 1 : 0;
+                interpolateRow(image + (size_t) bottom * step, geometry, rows[slot]);
+                m_rowIndices[(size_t) slot] = bottom;
+                bottomRow = rows[slot];
+            }
+
+            const float bottomWeight = geometry.weightY[(size_t) y] / 255.0f;
+            const float topWeight = 1.0f / 255.0f - bottomWeight;
+            for (int channel = 0; channel < 3; ++channel) {
+                const int plane = swapRB ? 2 - channel : channel;
+                float *const out = outTensor + plane * planeSize + (size_t) (geometry.padTop + y) * outputWidth;
+                std::fill(out, out + geometry.padLeft, kPadValue);
+                blendRows(topRow + channel * resizedWidth, bottomRow + channel * resizedWidth,
+                          topWeight, bottomWeight, out + geometry.padLeft, resizedWidth);
+                std::fill(out + geometry.padLeft + resizedWidth, out + geometry.padLeft + resizedWidth + padRight,
+                          kPadValue);
+            }
+        }
+    }
+
+/**
+ * Interpolate one BGR source row horizontally into 3 planar float rows of the resized width.
+ */
+    void LetterboxPreprocessor::interpolateRow(
+            const uint8_t *sourceRow,
+            const LetterboxGeometry &geometry,
+            float *outRow) const {
+        const int width = geometry.resizedSize.width;
+        const int32_t *offsets = geometry.sourceByteX.data();
+        const float *weights = geometry.weightX.data();
+
+        int x = 0;
+#if defined(NX_PLUGIN_SIMD_AVX2)
+        // A 32-bit gather at the byte offset of a channel of the left pixel fetches that channel of
+        // both the left (byte 0) and the right (byte 3) pixel. The left pixel is never the last one
+        // in the row, so the gather stays inside the row.
+        if (geometry.sourceSize.width > 1) {
+            const __m256i lowByteMask = _mm256_set1_epi32(0xFF);
+            for (; x + 8 <= width; x += 8) {
+                const __m256i byteOffsets = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(offsets + x));
+                const __m256 rightWeights = _mm256_loadu_ps(weights + x);
+                for (int channel = 0; channel < 3; ++channel) {
+                    const __m256i pixels = _mm256_i32gather_epi32(
+                            reinterpret_cast<const int *>(sourceRow + channel), byteOffsets, 1);
+                    const __m256 left = _mm256_cvtepi32_ps(_mm256_and_si256(pixels, lowByteMask));
+                    const __m256 right = _mm256_cvtepi32_ps(_mm256_srli_epi32(pixels, 24));
+                    const __m256 value = _mm256_add_ps(left, _mm256_mul_ps(_mm256_sub_ps(right, left), rightWeights));
+                    _mm256_storeu_ps(outRow + channel * width + x, value);
+                }
+            }
+        }
+#endif
+        const int32_t rightStep = geometry.sourceSize.width > 1 ? 3 : 0;
+        for (; x < width; ++x) {
+            const uint8_t *left = sourceRow + offsets[x];
+            const uint8_t *right = left + rightStep;
+            const float weight = weights[x];
+            for (int channel = 0; channel < 3; ++channel) {
+                outRow[channel * width + x] =
+                        (float) left[channel] + ((float) right[channel] - (float) left[channel]) * weight;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,83 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "region_proposals.h"
+
+#include <algorithm>
+
+namespace nx_meta_plugin {
+
+    /** Padding on every side of a region, as a fraction of its size. */
+    static constexpr float kRegionPadding = 0.25f;
+
+    /** Regions are grown to at least this many pixels per side. */
+    static constexpr int kMinRegionSize = 256;
+
+    /** More changed regions than this are noise or a global change; merging them is not worth it. */
+    static constexpr size_t kMaxChangedRegions = 64;
+
+    /** Proposals run in one detector batch, so there are at most this many of them. */
+    static constexpr size_t kMaxRegions = 8;
+
+    /** Above this fraction of the frame area, the whole frame is cheaper to detect on. */
+    static constexpr float kMaxAreaFraction = 0.5f;
+
+/**
+ * Grow the length [begin, begin + length) to at least minLength around its center, and keep it
+ * inside [0, limit).
+ */
+    static void growAndClamp(int *begin, int *length, int minLength, int limit) {
+        if (*length < minLength) {
+            *begin -= (minLength - *length) / 2;
+            *length = minLength;
+        }
+        *length = std::min(*length, limit);
+        *begin = std::max(0, std::min(*begin, limit - *length));
+    }
+
+    bool proposeRegions(
+            const std::vector<cv::Rect> &changedRegions,
+            const cv::Size &frameSize,
+            std::vector<cv::Rect> *outRegions) {
+        outRegions->clear();
+        if (changedRegions.size() > kMaxChangedRegions)
+            return false;
+
+        for (const cv::Rect &changedRegion: changedRegions) {
+            const int paddingX = (int) (kRegionPadding * (float) changedRegion.width);
+            const int paddingY = (int) (kRegionPadding * (float) changedRegion.height);
+            cv::Rect region(
+                    changedRegion.x - paddingX,
+                    changedRegion.y - paddingY,
+                    changedRegion.width + 2 * paddingX,
+                    changedRegion.height + 2 * paddingY);
+            growAndClamp(&region.x, &region.width, kMinRegionSize, frameSize.width);
+            growAndClamp(&region.y, &region.height, kMinRegionSize, frameSize.height);
+            outRegions->push_back(region);
+        }
+
+        // Merge until no two regions overlap; merging can make a region overlap another one.
+        std::vector<cv::Rect> &regions = *outRegions;
+        for (bool merged = true; merged;) {
+            merged = false;
+            for (size_t i = 0; i < regions.size() && !merged; ++i) {
+                for (size_t j = i + 1; j < regions.size(); ++j) {
+                    if ((regions[i] & regions[j]).area() > 0) {
+                        regions[i] |= regions[j];
+                        regions.erase(regions.begin() + (ptrdiff_t) j);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (regions.size() > kMaxRegions)
+            return false;
+
+        double area = 0;
+        for (const cv::Rect &region: regions)
+            area += region.area();
+        return area <= kMaxAreaFraction * frameSize.area();
+    }
+
+}
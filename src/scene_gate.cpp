@@ -0,0 +1,281 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "scene_gate.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "simd.h"
+
+namespace nx_meta_plugin {
+
+    /** Weight of the new thumbnail in the running average of the background. */
+    static constexpr float kBackgroundUpdateRate = 0.05f;
+
+    /** Mean absolute difference to the previous thumbnail below which the frame is unchanged. */
+    static constexpr float kUnchangedFrameDifference = 0.01f;
+
+    // A frame is black when both its mean and its brightest thumbnail pixel are this dark.
+    static constexpr float kBlackMeanLevel = 8;
+    static constexpr float kBlackMaxLevel = 24;
+
+    struct ThumbnailComparison {
+        size_t changedPixels = 0; /**< Pixels which differ from the background. */
+        float frameDifference = 0; /**< Sum of the absolute differences to the previous thumbnail. */
+        float sum = 0;
+        float max = 0;
+    };
+
+/**
+ * Compare the thumbnail with the background and the previous thumbnail, gather its brightness,
+ * and blend it into the background, in one pass.
+ *
+ * @param changedMask Receives one bit per pixel, set for the changed pixels; must be zeroed.
+ */
+    static ThumbnailComparison compareThumbnail(
+            const float *thumbnail,
+            const float *previousThumbnail,
+            float *background,
+            size_t size,
+            uint8_t *changedMask) {
+        ThumbnailComparison result;
+        size_t i = 0;
+#if defined(NX_PLUGIN_SIMD_AVX2)
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        const __m256 threshold = _mm256_set1_ps(SceneGate::kChangedPixelThreshold);
+        const __m256 updateRate = _mm256_set1_ps(kBackgroundUpdateRate);
+        const __m256 one = _mm256_set1_ps(1);
+        __m256 changed = _mm256_setzero_ps();
+        __m256 frameDifference = _mm256_setzero_ps();
+        __m256 sum = _mm256_setzero_ps();
+        __m256 max = _mm256_setzero_ps();
+        for (; i + 8 <= size; i += 8) {
+            const __m256 pixels = _mm256_loadu_ps(thumbnail + i);
+            const __m256 backgroundPixels = _mm256_loadu_ps(background + i);
+            const __m256 difference = _mm256_sub_ps(pixels, backgroundPixels);
+
+            const __m256 changedPixels = _mm256_cmp_ps(_mm256_and_ps(difference, absMask), threshold, _CMP_GT_OQ);
+            changed = _mm256_add_ps(changed, _mm256_and_ps(one, changedPixels));
+            changedMask[i / 8] = (uint8_t) _mm256_movemask_ps(changedPixels);
+            frameDifference = _mm256_add_ps(frameDifference, _mm256_and_ps(absMask,
+                    _mm256_sub_ps(pixels, _mm256_loadu_ps(previousThumbnail + i))));
+            sum = _mm256_add_ps(sum, pixels);
+            max = _mm256_max_ps(max, pixels);
+            _mm256_storeu_ps(background + i,
+                             _mm256_add_ps(backgroundPixels, _mm256_mul_ps(updateRate, difference)));
+        }
+        alignas(32) float lanes[4][8];
+        _mm256_store_ps(lanes[0], changed);
+        _mm256_store_ps(lanes[1], frameDifference);
+        _mm256_store_ps(lanes[2], sum);
+        _mm256_store_ps(lanes[3], max);
+        for (int lane = 0; lane < 8; ++lane) {
+            result.changedPixels += (size_t) lanes[0][lane];
+            result.frameDifference += lanes[1][lane];
+            result.sum += lanes[2][lane];
+            result.max = std::max(result.max, lanes[3][lane]);
+        }
+#elif defined(NX_PLUGIN_SIMD_SSE2)
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        const __m128 threshold = _mm_set1_ps(SceneGate::kChangedPixelThreshold);
+        const __m128 updateRate = _mm_set1_ps(kBackgroundUpdateRate);
+        const __m128 one = _mm_set1_ps(1);
+        __m128 changed = _mm_setzero_ps();
+        __m128 frameDifference = _mm_setzero_ps();
+        __m128 sum = _mm_setzero_ps();
+        __m128 max = _mm_setzero_ps();
+        for (; i + 4 <= size; i += 4) {
+            const __m128 pixels = _mm_loadu_ps(thumbnail + i);
+            const __m128 backgroundPixels = _mm_loadu_ps(background + i);
+            const __m128 difference = _mm_sub_ps(pixels, backgroundPixels);
+
+            const __m128 changedPixels = _mm_cmpgt_ps(_mm_and_ps(difference, absMask), threshold);
+            changed = _mm_add_ps(changed, _mm_and_ps(one, changedPixels));
+            changedMask[i / 8] |= (uint8_t) (_mm_movemask_ps(changedPixels) << (i % 8));
+            frameDifference = _mm_add_ps(frameDifference, _mm_and_ps(absMask,
+                    _mm_sub_ps(pixels, _mm_loadu_ps(previousThumbnail + i))));
+            sum = _mm_add_ps(sum, pixels);
+            max = _mm_max_ps(max, pixels);
+            _mm_storeu_ps(background + i, _mm_add_ps(backgroundPixels, _mm_mul_ps(updateRate, difference)));
+        }
+        alignas(16) float lanes[4][4];
+        _mm_store_ps(lanes[0], changed);
+        _mm_store_ps(lanes[1], frameDifference);
+        _mm_store_ps(lanes[2], sum);
+        _mm_store_ps(lanes[3], max);
+        for (int lane = 0; lane < 4; ++lane) {
+            result.changedPixels += (size_t) lanes[0][lane];
+            result.frameDifference += lanes[1][lane];
+            result.sum += lanes[2][lane];
+            result.max = std::max(result.max, lanes[3][lane]);
+        }
+#endif
+        for (; i < size; ++i) {
+            const float difference = thumbnail[i] - background[i];
+            if (std::abs(difference) > SceneGate::kChangedPixelThreshold) {
+                ++result.changedPixels;
+                changedMask[i / 8] |= (uint8_t) (1 << (i % 8));
+            }
+            result.frameDifference += std::abs(thumbnail[i] - previousThumbnail[i]);
+            result.sum += thumbnail[i];
+            result.max = std::max(result.max, thumbnail[i]);
+            background[i] += kBackgroundUpdateRate * difference;
+        }
+        return result;
+    }
+
+    SceneGate::Decision SceneGate::check(const cv::Mat &image, int64_t timestampUs, bool hasActiveTracks) {
+        ++m_stats.checkedFrames;
+
+        // Start over when the resolution changes or the timestamps go back.
+        const bool restart = image.size() != m_imageSize || timestampUs < m_lastRefreshUs;
+        m_imageSize = image.size();
+        std::swap(m_thumbnail, m_previousThumbnail);
+        makeThumbnail(image);
+        if (restart) {
+            m_background = m_thumbnail;
+            m_previousThumbnail = m_thumbnail;
+            m_changedMask.assign((m_thumbnail.size() + 7) / 8, 0);
+            m_unchangedSinceUs = -1;
+            m_lastRefreshUs = timestampUs;
+            return Decision::refresh;
+        }
+
+        const size_t size = m_thumbnail.size();
+        m_changedMask.assign((size + 7) / 8, 0);
+        const ThumbnailComparison comparison = compareThumbnail(
+                m_thumbnail.data(), m_previousThumbnail.data(), m_background.data(), size, m_changedMask.data());
+
+        if (comparison.sum / (float) size < kBlackMeanLevel && comparison.max < kBlackMaxLevel) {
+            ++m_stats.skippedBlack;
+            return Decision::skipBlack;
+        }
+
+        if (comparison.frameDifference / (float) size < kUnchangedFrameDifference) {
+            if (m_unchangedSinceUs < 0)
+                m_unchangedSinceUs = timestampUs;
+            if (timestampUs - m_unchangedSinceUs >= kFrozenDurationUs) {
+                ++m_stats.skippedFrozen;
+                return Decision::skipFrozen;
+            }
+        } else {
+            m_unchangedSinceUs = -1;
+        }
+
+        // Periodically, on the whole frame, so that stationary objects are still found.
+        if (timestampUs - m_lastRefreshUs >= m_refreshIntervalUs) {
+            m_lastRefreshUs = timestampUs;
+            return Decision::refresh;
+        }
+
+        const bool motion = (float) comparison.changedPixels > kMotionFraction * (float) size;
+        if (!motion && !hasActiveTracks) {
+            ++m_stats.skippedStatic;
+            return Decision::skipStatic;
+        }
+
+        return Decision::detect;
+    }
+
+    bool SceneGate::hasChangedPixels(const cv::Rect &region, const cv::Size &frameSize) const {
+        if (m_changedMask.empty() || frameSize.width <= 0 || frameSize.height <= 0)
+            return true;
+
+        // Thumbnail pixels whose center is inside the region.
+        const int left = std::max(0, region.x * kThumbnailWidth / frameSize.width);
+        const int top = std::max(0, region.y * kThumbnailHeight / frameSize.height);
+        const int right = std::min(kThumbnailWidth, (region.x + region.width) * kThumbnailWidth / frameSize.width + 1);
+        const int bottom = std::min(kThumbnailHeight, (region.y + region.height) * kThumbnailHeight / frameSize.height + 1);
+        for (int y = top; y < bottom; ++y) {
+            for (int x = left; x < right; ++x) {
+                const size_t i = (size_t) y * kThumbnailWidth + (size_t) x;
+                if (m_changedMask[i / 8] & (1 << (i % 8)))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+/**
+ * Flood-fill the 8-connected groups of changed thumbnail pixels.
+ */
+    const std::vector<cv::Rect> &SceneGate::changedRegions(const cv::Size &frameSize) {
+        m_changedRegions.clear();
+        if (m_changedMask.empty())
+            return m_changedRegions;
+
+        const auto isChanged =
+                [this](int i) { return (m_changedMask[(size_t) i / 8] & (1 << (i % 8))) != 0; };
+
+        m_visited.assign((size_t) kThumbnailWidth * kThumbnailHeight, 0);
+        for (int seed = 0; seed < kThumbnailWidth * kThumbnailHeight; ++seed) {
+            if (m_visited[(size_t) seed] || !isChanged(seed))
+                continue;
+
+            int left = seed % kThumbnailWidth;
+            int top = seed / kThumbnailWidth;
+            int right = left;
+            int bottom = top;
+            m_visited[(size_t) seed] = 1;
+            m_pixelStack.assign(1, seed);
+            while (!m_pixelStack.empty()) {
+                const int i = m_pixelStack.back();
+                m_pixelStack.pop_back();
+                const int x = i % kThumbnailWidth;
+                const int y = i / kThumbnailWidth;
+                left = std::min(left, x);
+                right = std::max(right, x);
+                top = std::min(top, y);
+                bottom = std::max(bottom, y);
+
+                for (int ny = std::max(0, y - 1); ny <= std::min(kThumbnailHeight - 1, y + 1); ++ny) {
+                    for (int nx = std::max(0, x - 1); nx <= std::min(kThumbnailWidth - 1, x + 1); ++nx) {
+                        const int neighbour = ny * kThumbnailWidth + nx;
+                        if (!m_visited[(size_t) neighbour] && isChanged(neighbour)) {
+                            m_visited[(size_t) neighbour] = 1;
+                            m_pixelStack.push_back(neighbour);
+                        }
+                    }
+                }
+            }
+
+            // Blocks of the frame the thumbnail pixels were sampled from.
+            const int x1 = left * frameSize.width / kThumbnailWidth;
+            const int y1 = top * frameSize.height / kThumbnailHeight;
+            const int x2 = (right + 1) * frameSize.width / kThumbnailWidth;
+            const int y2 = (bottom + 1) * frameSize.height / kThumbnailHeight;
+            m_changedRegions.emplace_back(x1, y1, x2 - x1, y2 - y1);
+        }
+        return m_changedRegions;
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+/**
+ * Reduce the frame to kThumbnailWidth x kThumbnailHeight grayscale pixels, each the mean of a
+ * 2x2 grid of samples from its block of the frame, which averages out most of the sensor noise.
+ */
+    void SceneGate::makeThumbnail(const cv::Mat &image) {
+        m_thumbnail.resize((size_t) kThumbnailWidth * kThumbnailHeight);
+
+        const auto sample =
+                [&image](int x, int y) {
+                    const uint8_t *pixel = image.ptr<uint8_t>(y) + 3 * x;
+                    return 0.114f * pixel[0] + 0.587f * pixel[1] + 0.299f * pixel[2];
+                };
+
+        float *thumbnailPixel = m_thumbnail.data();
+        for (int y = 0; y < kThumbnailHeight; ++y) {
+            const int top = (4 * y + 1) * image.rows / (4 * kThumbnailHeight);
+            const int bottom = (4 * y + 3) * image.rows / (4 * kThumbnailHeight);
+            for (int x = 0; x < kThumbnailWidth; ++x) {
+                const int left = (4 * x + 1) * image.cols / (4 * kThumbnailWidth);
+                const int right = (4 * x + 3) * image.cols / (4 * kThumbnailWidth);
+                *thumbnailPixel++ =
+                        0.25f * (sample(left, top) + sample(right, top) + sample(left, bottom) + sample(right, bottom));
+            }
+        }
+    }
+
+}
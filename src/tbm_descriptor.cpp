@@ -0,0 +1,282 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "tbm_descriptor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+#include "simd.h"
+
+namespace nx_meta_plugin {
+
+    using namespace cv::tbm;
+
+    /** Longest descriptor for which the 32-bit sums of the correlation cannot overflow. */
+    static constexpr size_t kMaxCorrelatedSize = 1 << 16;
+
+    /** Source coordinate and weight of the next one, as cv::resize() with INTER_LINEAR maps them. */
+    struct SampleTap {
+        int offset = 0;
+        int nextOffset = 0;
+        float weight = 0;
+    };
+
+    static SampleTap sampleTap(int index, float scale, int sourceSize) {
+        const float position = std::max(0.0f, ((float) index + 0.5f) * scale - 0.5f);
+        SampleTap tap;
+        tap.offset = (int) position;
+        tap.weight = position - (float) tap.offset;
+        if (tap.offset >= sourceSize - 1) {
+            tap.offset = sourceSize - 1;
+            tap.weight = 0;
+        }
+        tap.nextOffset = std::min(tap.offset + 1, sourceSize - 1);
+        return tap;
+    }
+
+/**
+ * Bilinearly sample the box of the CV_8UC3 image to a new kWidth x kHeight descriptor. A new
+ * matrix every time, because cv::tbm keeps the descriptors in its tracks.
+ */
+    static cv::Mat sampleBox(const cv::Mat &image, const cv::Rect &box) {
+        CV_Assert(image.type() == CV_8UC3);
+
+        constexpr int kWidth = SampledImageDescriptor::kWidth;
+        constexpr int kHeight = SampledImageDescriptor::kHeight;
+        cv::Mat descriptor(kHeight, kWidth, CV_8UC3, cv::Scalar::all(0));
+        const cv::Rect area = box & cv::Rect(0, 0, image.cols, image.rows);
+        if (area.empty())
+            return descriptor;
+
+        SampleTap columns[kWidth];
+        for (int x = 0; x < kWidth; ++x)
+            columns[x] = sampleTap(x, (float) area.width / kWidth, area.width);
+
+        for (int y = 0; y < kHeight; ++y) {
+            const SampleTap row = sampleTap(y, (float) area.height / kHeight, area.height);
+            const uint8_t *top = image.ptr<uint8_t>(area.y + row.offset) + area.x * 3;
+            const uint8_t *bottom = image.ptr<uint8_t>(area.y + row.nextOffset) + area.x * 3;
+            uint8_t *output = descriptor.ptr<uint8_t>(y);
+            for (int x = 0; x < kWidth; ++x) {
+                const SampleTap &column = columns[x];
+                const int left = column.offset * 3;
+                const int right = column.nextOffset * 3;
+                for (int channel = 0; channel < 3; ++channel) {
+                    const float upper = (float) top[left + channel]
+                                        + column.weight * (float) (top[right + channel] - top[left + channel]);
+                    const float lower = (float) bottom[left + channel]
+                                        + column.weight * (float) (bottom[right + channel] - bottom[left + channel]);
+                    output[x * 3 + channel] = (uint8_t) std::lround(upper + row.weight * (lower - upper));
+                }
+            }
+        }
+        return descriptor;
+    }
+
+/**
+ * Whether cv::tbm keeps the detection; the test of TrackerByMatching::FilterDetections().
+ */
+    static bool isKeptByTracker(const TrackedObject &detection, const TrackerParams &params) {
+        const float aspectRatio = (float) detection.rect.height / (float) detection.rect.width;
+        const float height = (float) detection.rect.height;
+        return detection.confidence > params.min_det_conf
+               && params.bbox_aspect_ratios_range[0] <= aspectRatio
+               && aspectRatio <= params.bbox_aspect_ratios_range[1]
+               && params.bbox_heights_range[0] <= height
+               && height <= params.bbox_heights_range[1];
+    }
+
+    static bool isStationary(const cv::Rect &box, const cv::Rect &previousBox) {
+        constexpr int kTolerance = SampledImageDescriptor::kStationaryTolerance;
+        return std::abs(box.x - previousBox.x) <= kTolerance
+               && std::abs(box.y - previousBox.y) <= kTolerance
+               && std::abs(box.x + box.width - previousBox.x - previousBox.width) <= kTolerance
+               && std::abs(box.y + box.height - previousBox.y - previousBox.height) <= kTolerance;
+    }
+
+/**
+ * @return Normalized cross-correlation of the two byte arrays: sum(a * b) / sqrt(sum(a * a) *
+ *     sum(b * b)), or 0 if either is all zeros, as cv::matchTemplate() with TM_CCORR_NORMED.
+ */
+    static double crossCorrelation(const uint8_t *a, const uint8_t *b, size_t size) {
+        // Products of bytes summed in pairs fit 17 bits, so 32-bit lanes hold the sums of the
+        // descriptors up to kMaxCorrelatedSize.
+        int64_t productSum = 0;
+        int64_t squareSumA = 0;
+        int64_t squareSumB = 0;
+        size_t i = 0;
+#if defined(NX_PLUGIN_SIMD_AVX2)
+        __m256i products = _mm256_setzero_si256();
+        __m256i squaresA = _mm256_setzero_si256();
+        __m256i squaresB = _mm256_setzero_si256();
+        for (; i + 16 <= size; i += 16) {
+            const __m256i valuesA = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (a + i)));
+            const __m256i valuesB = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (b + i)));
+            products = _mm256_add_epi32(products, _mm256_madd_epi16(valuesA, valuesB));
+            squaresA = _mm256_add_epi32(squaresA, _mm256_madd_epi16(valuesA, valuesA));
+            squaresB = _mm256_add_epi32(squaresB, _mm256_madd_epi16(valuesB, valuesB));
+        }
+        alignas(32) int32_t lanes[3][8];
+        _mm256_store_si256((__m256i *) lanes[0], products);
+        _mm256_store_si256((__m256i *) lanes[1], squaresA);
+        _mm256_store_si256((__m256i *) lanes[2], squaresB);
+        for (int lane = 0; lane < 8; ++lane) {
+            productSum += lanes[0][lane];
+            squareSumA += lanes[1][lane];
+            squareSumB += lanes[2][lane];
+        }
+#elif defined(NX_PLUGIN_SIMD_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i products = _mm_setzero_si128();
+        __m128i squaresA = _mm_setzero_si128();
+        __m128i squaresB = _mm_setzero_si128();
+        for (; i + 16 <= size; i += 16) {
+            const __m128i bytesA = _mm_loadu_si128((const __m128i *) (a + i));
+            const __m128i bytesB = _mm_loadu_si128((const __m128i *) (b + i));
+            const __m128i lowA = _mm_unpacklo_epi8(bytesA, zero);
+            const __m128i highA = _mm_unpackhi_epi8(bytesA, zero);
+            const __m128i lowB = _mm_unpacklo_epi8(bytesB, zero);
+            const __m128i highB = _mm_unpackhi_epi8(bytesB, zero);
+            products = _mm_add_epi32(products,
+                    _mm_add_epi32(_mm_madd_epi16(lowA, lowB), _mm_madd_epi16(highA, highB)));
+            squaresA = _mm_add_epi32(squaresA,
+                    _mm_add_epi32(_mm_madd_epi16(lowA, lowA), _mm_madd_epi16(highA, highA)));
+            squaresB = _mm_add_epi32(squaresB,
+                    _mm_add_epi32(_mm_madd_epi16(lowB, lowB), _mm_madd_epi16(highB, highB)));
+        }
+        alignas(16) int32_t lanes[3][4];
+        _mm_store_si128((__m128i *) lanes[0], products);
+        _mm_store_si128((__m128i *) lanes[1], squaresA);
+        _mm_store_si128((__m128i *) lanes[2], squaresB);
+        for (int lane = 0; lane < 4; ++lane) {
+            productSum += lanes[0][lane];
+            squareSumA += lanes[1][lane];
+            squareSumB += lanes[2][lane];
+        }
+#endif
+        for (; i < size; ++i) {
+            productSum += (int32_t) a[i] * b[i];
+            squareSumA += (int32_t) a[i] * a[i];
+            squareSumB += (int32_t) b[i] * b[i];
+        }
+
+        const double norm = std::sqrt((double) squareSumA * (double) squareSumB);
+        return norm > 0 ? (double) productSum / norm : 0;
+    }
+
+//-------------------------------------------------------------------------------------------------
+// public
+
+    cv::Size SampledImageDescriptor::size() const {
+        return cv::Size(kWidth, kHeight);
+    }
+
+    void SampledImageDescriptor::compute(const cv::Mat &mat, cv::Mat &descriptor) {
+        if (m_nextPrepared < m_prepared.size()) {
+            const PreparedDescriptor &prepared = m_prepared[m_nextPrepared];
+            if (prepared.box.size() == mat.size()) {
+                descriptor = prepared.descriptor;
+                ++m_nextPrepared;
+                return;
+            }
+
+            // Not the crop prepare() expected: the order is lost, so sample the crops from now on.
+            m_nextPrepared = m_prepared.size();
+        }
+
+        descriptor = sampleBox(mat, cv::Rect(0, 0, mat.cols, mat.rows));
+        ++m_stats.sampled;
+    }
+
+    void SampledImageDescriptor::compute(const std::vector<cv::Mat> &mats, std::vector<cv::Mat> &descriptors) {
+        descriptors.resize(mats.size());
+        for (size_t i = 0; i < mats.size(); ++i)
+            compute(mats[i], descriptors[i]);
+    }
+
+/**
+ * A descriptor is reused only when the detection and the previous box match one to one: the
+ * detection is stationary relative to this previous box alone, and the previous box to this
+ * detection alone. Two people standing close could otherwise both get the descriptor of one of
+ * them, which would change the association of cv::tbm.
+ */
+    void SampledImageDescriptor::prepare(
+            const cv::Mat &frame,
+            const TrackedObjects &detections,
+            const TrackerParams &params) {
+        m_previous.swap(m_prepared);
+        m_prepared.clear();
+        m_nextPrepared = 0;
+
+        // Stationary boxes are compared with the box the descriptor was sampled from, so that a
+        // slow drift is not mistaken for standing still.
+        const auto canReuse =
+                [](const TrackedObject &detection, const PreparedDescriptor &previous) {
+                    return previous.reuseCount < kMaxReuseFrames
+                           && isStationary(detection.rect, previous.sampledBox);
+                };
+
+        m_previousMatchCounts.assign(m_previous.size(), 0);
+        for (const TrackedObject &detection: detections) {
+            if (!isKeptByTracker(detection, params))
+                continue;
+            for (size_t i = 0; i < m_previous.size(); ++i) {
+                if (canReuse(detection, m_previous[i]))
+                    ++m_previousMatchCounts[i];
+            }
+        }
+
+        for (const TrackedObject &detection: detections) {
+            if (!isKeptByTracker(detection, params))
+                continue;
+
+            PreparedDescriptor prepared;
+            prepared.box = detection.rect;
+            prepared.sampledBox = detection.rect;
+
+            const PreparedDescriptor *previous = nullptr;
+            int matchCount = 0;
+            for (size_t i = 0; i < m_previous.size(); ++i) {
+                if (canReuse(detection, m_previous[i])) {
+                    ++matchCount;
+                    if (m_previousMatchCounts[i] == 1)
+                        previous = &m_previous[i];
+                }
+            }
+            if (matchCount == 1 && previous) {
+                prepared.sampledBox = previous->sampledBox;
+                prepared.descriptor = previous->descriptor;
+                prepared.reuseCount = previous->reuseCount + 1;
+                ++m_stats.reused;
+            } else {
+                prepared.descriptor = sampleBox(frame, detection.rect);
+                ++m_stats.sampled;
+            }
+            m_prepared.push_back(std::move(prepared));
+        }
+    }
+
+    float CrossCorrelationDistance::compute(const cv::Mat &descriptor1, const cv::Mat &descriptor2) {
+        CV_Assert(descriptor1.depth() == CV_8U && descriptor1.type() == descriptor2.type());
+        CV_Assert(descriptor1.size() == descriptor2.size());
+        CV_Assert(descriptor1.isContinuous() && descriptor2.isContinuous());
+
+        const size_t size = descriptor1.total() * descriptor1.elemSize();
+        CV_Assert(size <= kMaxCorrelatedSize);
+        return (float) (1 - crossCorrelation(descriptor1.ptr<uint8_t>(), descriptor2.ptr<uint8_t>(), size));
+    }
+
+    std::vector<float> CrossCorrelationDistance::compute(
+            const std::vector<cv::Mat> &descriptors1,
+            const std::vector<cv::Mat> &descriptors2) {
+        CV_Assert(descriptors1.size() == descriptors2.size());
+
+        std::vector<float> result(descriptors1.size());
+        for (size_t i = 0; i < descriptors1.size(); ++i)
+            result[i] = compute(descriptors1[i], descriptors2[i]);
+        return result;
+    }
+
+}
@@ -0,0 +1,111 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "tbm_tracker_backend.h"
+
+namespace nx_meta_plugin {
+
+    using namespace cv;
+    using namespace cv::tbm;
+
+/**
+ * This function implementation is based on the sample from opencv_contrib repository:
+ * https://github.com/opencv/opencv_contrib/blob/0a2179b328/modules/tracking/samples/tracking_by_matching.cpp
+ *
+ * The fast descriptor and distance of the sample (ResizedImageDescriptor and
+ * MatchTemplateDistance) are replaced with equivalent ones which cost a fraction of the time.
+ */
+    static cv::Ptr<ITrackerByMatching> createTrackerByMatchingWithFastDescriptor(
+            const std::shared_ptr<SampledImageDescriptor> &descriptor) {
+        TrackerParams params;
+
+        // Counted in processed frames; adjusted by ObjectTracker::setDetectionRate().
+        params.forget_delay = 75;
+
+        cv::Ptr<ITrackerByMatching> tracker = createTrackerByMatching(params);
+
+        tracker->setDescriptorFast(descriptor);
+        tracker->setDistanceFast(std::make_shared<CrossCorrelationDistance>());
+
+        return tracker;
+    }
+
+//-------------------------------------------------------------------------------------------------
+// public
+
+    TbmTrackerBackend::TbmTrackerBackend() :
+            m_descriptor(std::make_shared<SampledImageDescriptor>()),
+            m_tracker(createTrackerByMatchingWithFastDescriptor(m_descriptor)) {
+    }
+
+    TrackedObjects TbmTrackerBackend::process(
+            const cv::Mat &frame,
+            const TrackedObjects &detections,
+            int64_t timestampUs) {
+        m_descriptor->prepare(frame, detections, m_tracker->params());
+        m_tracker->process(frame, detections, (uint64_t) timestampUs);
+        dropForgottenTracks();
+        return m_tracker->trackedDetections();
+    }
+
+    void TbmTrackerBackend::setForgetDelay(size_t frameCount) {
+        if (m_tracker->params().forget_delay == frameCount)
+            return;
+
+        TrackerParams params = m_tracker->params();
+        params.forget_delay = frameCount;
+        m_tracker->setParams(params);
+    }
+
+    bool TbmTrackerBackend::hasActiveTracks() const {
+        for (const auto &track: m_tracker->tracks()) {
+            if (!m_tracker->isTrackForgotten(track.first))
+                return true;
+        }
+        return false;
+    }
+
+    void TbmTrackerBackend::trackMotions(std::vector<TrackMotion> *outTrackMotions) const {
+        outTrackMotions->clear();
+        for (const auto &track: m_tracker->tracks()) {
+            const TrackedObjects &objects = track.second.objects;
+            if (objects.empty() || m_tracker->isTrackForgotten(track.first))
+                continue;
+
+            const TrackedObject &last = objects.back();
+            TrackMotion motion;
+            motion.box = last.rect;
+            motion.timestampUs = (int64_t) last.timestamp;
+            if (objects.size() >= 2) {
+                const TrackedObject &previous = objects[objects.size() - 2];
+                const float elapsedS = (float) ((int64_t) last.timestamp - (int64_t) previous.timestamp) / 1'000'000;
+                if (elapsedS > 0) {
+                    // Velocity of the box center.
+                    motion.velocity.x = ((float) (last.rect.x - previous.rect.x)
+                                         + (float) (last.rect.width - previous.rect.width) / 2) / elapsedS;
+                    motion.velocity.y = ((float) (last.rect.y - previous.rect.y)
+                                         + (float) (last.rect.height - previous.rect.height) / 2) / elapsedS;
+                }
+            }
+            outTrackMotions->push_back(motion);
+        }
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+/**
+ * cv::tbm keeps the forgotten tracks until they are dropped. They are dropped one by one rather
+ * than by dropForgottenTracks(), which renumbers the tracks once the ids grow large, while the ids
+ * of this backend are never reused.
+ */
+    void TbmTrackerBackend::dropForgottenTracks() {
+        m_forgottenTrackIds.clear();
+        for (const auto &track: m_tracker->tracks()) {
+            if (m_tracker->isTrackForgotten(track.first))
+                m_forgottenTrackIds.push_back(track.first);
+        }
+        for (const size_t id: m_forgottenTrackIds)
+            m_tracker->dropForgottenTrack(id);
+    }
+
+}
@@ -0,0 +1,60 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "tiling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace nx_meta_plugin {
+
+    /** Tiles per side at most; more would not fit a reasonable inference batch. */
+    static constexpr int kMaxTilesPerSide = 4;
+
+    TileLayout TileLayout::fromString(const std::string &value, float overlap) {
+        TileLayout layout;
+        layout.overlap = std::max(0.0f, std::min(overlap, 0.5f));
+
+        int columns = 0;
+        int rows = 0;
+        if (std::sscanf(value.c_str(), "%dx%d", &columns, &rows) == 2
+            && columns >= 1 && columns <= kMaxTilesPerSide && rows >= 1 && rows <= kMaxTilesPerSide) {
+            layout.columns = columns;
+            layout.rows = rows;
+        }
+        return layout;
+    }
+
+/**
+ * @return Offsets of `count` tiles of length tileLength spread evenly over length.
+ */
+    static std::vector<int> tileOffsets(int length, int count, float overlap, int *outTileLength) {
+        // count tiles overlapping by `overlap` of a tile cover count - (count - 1) * overlap tiles.
+        const int tileLength = std::min(length, (int) std::ceil(length / (count - (count - 1) * overlap)));
+        *outTileLength = tileLength;
+
+        std::vector<int> offsets(count, 0);
+        for (int i = 1; i < count; ++i)
+            offsets[i] = (int) std::lround((double) i * (length - tileLength) / (count - 1));
+        return offsets;
+    }
+
+    std::vector<cv::Rect> makeTiles(const cv::Size &frameSize, const TileLayout &layout) {
+        if (!layout.isTiled())
+            return {cv::Rect(0, 0, frameSize.width, frameSize.height)};
+
+        int tileWidth = 0;
+        int tileHeight = 0;
+        const std::vector<int> xs = tileOffsets(frameSize.width, layout.columns, layout.overlap, &tileWidth);
+        const std::vector<int> ys = tileOffsets(frameSize.height, layout.rows, layout.overlap, &tileHeight);
+
+        std::vector<cv::Rect> tiles;
+        tiles.reserve(xs.size() * ys.size());
+        for (const int y: ys) {
+            for (const int x: xs)
+                tiles.emplace_back(x, y, tileWidth, tileHeight);
+        }
+        return tiles;
+    }
+
+}
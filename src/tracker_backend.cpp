@@ -0,0 +1,34 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "tracker_backend.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "byte_tracker.h"
+#include "tbm_tracker_backend.h"
+
+namespace nx_meta_plugin {
+
+    cv::Rect TrackMotion::predict(int64_t targetTimestampUs) const {
+        const int64_t elapsedUs = std::max<int64_t>(
+                0, std::min(targetTimestampUs - timestampUs, kMaxPredictionTimeUs));
+        const float elapsedS = (float) elapsedUs / 1'000'000;
+        return cv::Rect(
+                box.x + (int) std::lround(velocity.x * elapsedS),
+                box.y + (int) std::lround(velocity.y * elapsedS),
+                box.width,
+                box.height);
+    }
+
+    std::unique_ptr<TrackerBackend> createTrackerBackend(TrackerType type) {
+        switch (type) {
+            case TrackerType::byteTrack:
+                return std::make_unique<ByteTracker>();
+            case TrackerType::tbm:
+                break;
+        }
+        return std::make_unique<TbmTrackerBackend>();
+    }
+
+}
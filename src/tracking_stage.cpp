@@ -0,0 +1,107 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "tracking_stage.h"
+
+#include <nx/kit/debug.h>
+
+#include "allocation_counter.h"
+
+namespace nx_meta_plugin {
+
+    using namespace nx::sdk;
+    using namespace nx::sdk::analytics;
+
+//-------------------------------------------------------------------------------------------------
+// public
+
+    TrackingStage::TrackingStage(RegionClassifier *classifier, TrackerType trackerType) :
+            m_classifier(classifier),
+            m_objectTracker(std::make_unique<ObjectTracker>(trackerType)),
+            m_trackerType(trackerType) {
+    }
+
+    void TrackingStage::setClassificationInterval(int64_t intervalUs) {
+        m_classificationCache.setRefreshInterval(intervalUs);
+    }
+
+    Ptr<ObjectMetadataPacket> TrackingStage::run(const Frame &frame, FrameMemory *memory) {
+        {
+            const AllocationScope allocationScope(AllocationStage::tracking);
+            resetTracksOnChanges(frame);
+            if (m_detectionRateHz > 0)
+                m_objectTracker->setDetectionRate(m_detectionRateHz);
+
+            m_objectTracker->run(frame, memory->detections, &memory->trackedDetections);
+            m_hasActiveTracks = m_objectTracker->hasActiveTracks();
+            const std::lock_guard<std::mutex> lock(m_trackMotionsMutex);
+            m_objectTracker->trackMotions(&m_trackMotions);
+        }
+
+        classify(frame, memory);
+
+        const AllocationScope allocationScope(AllocationStage::metadata);
+        return m_objectMetadataBuilder.build(memory->trackedDetections, frame);
+    }
+
+    void TrackingStage::trackMotions(std::vector<TrackMotion> *outTrackMotions) const {
+        const std::lock_guard<std::mutex> lock(m_trackMotionsMutex);
+        outTrackMotions->assign(m_trackMotions.begin(), m_trackMotions.end());
+    }
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+/**
+ * Start over with new tracks when the tracker type or the frame size changes; the objects get new
+ * track ids, so everything known about the old ones is forgotten.
+ */
+    void TrackingStage::resetTracksOnChanges(const Frame &frame) {
+        const bool frameSizeChanged = m_frameWidth != 0
+                                      && (frame.width != m_frameWidth || frame.height != m_frameHeight);
+        m_frameWidth = frame.width;
+        m_frameHeight = frame.height;
+        if (!frameSizeChanged && m_objectTracker->type() == m_trackerType)
+            return;
+
+        m_objectTracker = std::make_unique<ObjectTracker>(m_trackerType);
+        m_classificationCache.clear();
+        m_objectMetadataBuilder.clear();
+    }
+
+/**
+ * Label the tracked detections: by the classification cache where their track label is known,
+ * and by the classifier otherwise, all the crops in one call so that they are batched.
+ */
+    void TrackingStage::classify(const Frame &frame, FrameMemory *memory) {
+        const AllocationScope allocationScope(AllocationStage::classification);
+
+        DetectionBatch *const detections = &memory->trackedDetections;
+        m_classifiedDetections.clear();
+        m_classifiedRegions.clear();
+        for (size_t i = 0; i < detections->size(); ++i) {
+            if (m_classificationCache.lookup(detections->trackIds[i], frame.timestampUs, &detections->labels[i]))
+                continue;
+
+            m_classifiedDetections.push_back(i);
+            m_classifiedRegions.push_back(detections->boxes[i]);
+        }
+
+        if (!m_classifiedRegions.empty()) {
+            const std::pmr::vector<Classification> classifications =
+                    m_classifier->run(frame.cvMat, m_classifiedRegions, &memory->arena);
+            for (size_t i = 0; i < m_classifiedDetections.size(); ++i) {
+                const size_t index = m_classifiedDetections[i];
+                detections->labels[index] = m_classificationCache.update(
+                        detections->trackIds[index], classifications[i], frame.timestampUs);
+            }
+        }
+        m_classificationCache.removeStale(frame.timestampUs);
+
+        if (++m_classifiedFrameCount % kClassificationReportPeriod == 0) {
+            const ClassificationCache::Stats &stats = m_classificationCache.stats();
+            NX_PRINT << "Classification cache: " << stats.hits << " of " << stats.lookups
+                     << " tracked people not classified (" << (int) (100 * stats.hitRate()) << "% hit rate)";
+        }
+    }
+
+}
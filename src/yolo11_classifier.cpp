@@ -1,17 +1,25 @@
 // Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
 
+#include "yolo11_classifier.h"
+
+#include <algorithm>
+#include <map>
 
 #include <opencv2/core.hpp>
 
-#include "yolo11_classifier.h"
 #include "exceptions.h"
 
 namespace nx_meta_plugin {
     using namespace std::string_literals;
     using namespace cv;
 
-    YOLO11Classifier::YOLO11Classifier(std::filesystem::path modelDir) :
-            m_modelDir(std::move(modelDir)) {
+    YOLO11Classifier::YOLO11Classifier(
+            std::filesystem::path modelDir,
+            std::shared_ptr<ModelRegistry> modelRegistry,
+            const ModelOptions &modelOptions) :
+            m_modelDir(std::move(modelDir)),
+            m_modelOptions(modelOptions),
+            m_modelRegistry(std::move(modelRegistry)) {
     }
 
 /**
@@ -47,12 +55,15 @@ namespace nx_meta_plugin {
         m_terminated = true;
     }
 
-    std::string YOLO11Classifier::run(const cv::Mat &frame) {
+    std::pmr::vector<Classification> YOLO11Classifier::run(
+            const cv::Mat &frame,
+            const std::vector<cv::Rect> &regions,
+            std::pmr::memory_resource *memory) {
         if (isTerminated())
             throw ObjectDetectorIsTerminatedError("Detection error: object detector is terminated.");
 
         try {
-            return runImpl(frame);
+            return runImpl(frame, regions, memory);
         }
         catch (const cv::Exception &e) {
             terminate();
@@ -64,261 +75,180 @@ namespace nx_meta_plugin {
         }
     }
 
+    void YOLO11Classifier::setSizeBucketing(bool enabled) {
+        m_sizeBucketing = enabled;
+    }
+
     void YOLO11Classifier::loadModel() {
-        // Initialize ONNX Runtime environment with warning level
-        env = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "ONNX_DETECTION");
-        sessionOptions = Ort::SessionOptions();
-
-        // Set number of intra-op threads for parallelism
-        sessionOptions.SetIntraOpNumThreads(std::min(6, static_cast<int>(std::thread::hardware_concurrency())));
-        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-
-        // Retrieve available execution providers (e.g., CPU, CUDA)
-        std::vector<std::string> availableProviders = Ort::GetAvailableProviders();
-        auto cudaAvailable = std::find(availableProviders.begin(), availableProviders.end(),
-                                       "CUDAExecutionProvider");
-        OrtCUDAProviderOptions cudaOption;
-
-        // Configure session options based on whether GPU is to be used and available
-        if (useGPU && cudaAvailable != availableProviders.end()) {
-            std::cout << "Inference device: GPU" << std::endl;
-            sessionOptions.AppendExecutionProvider_CUDA(cudaOption); // Append CUDA execution provider
-        } else {
-            if (useGPU) {
-                std::cout << "GPU is not supported by your ONNXRuntime build. Fallback to CPU." << std::endl;
-            }
-            std::cout << "Inference device: CPU" << std::endl;
-        }
+        // The session is shared with all other DeviceAgents which use the same model.
+        ModelOptions options = m_modelOptions;
+        options.useGpu = useGPU;
+        m_session = m_modelRegistry->acquire(
+                m_modelDir / std::filesystem::path("yolov11n-classify.onnx"), options);
+        m_boundSession = std::make_unique<BoundSession>(m_session.get());
+
+        m_netLoaded = true;
+    }
 
-        // Load the ONNX model into the session
-        std::filesystem::path modelPath = m_modelDir / std::filesystem::path("yolov11n-classify.onnx");
-        std::string modelPathStr{modelPath.u8string()};
-        std::cout << "Classification model path: " << modelPathStr << std::endl;
-#ifdef _WIN32
-        std::wstring w_modelPath(modelPathStr.begin(), m_modelPath.end());
-        session = Ort::Session(env, w_modelPath.c_str(), sessionOptions);
-#else
-        session = Ort::Session(env, modelPathStr.c_str(), sessionOptions);
-#endif
-
-        Ort::AllocatorWithDefaultOptions allocator;
-
-        // Retrieve input tensor shape information
-        Ort::TypeInfo inputTypeInfo = session.GetInputTypeInfo(0);
-        std::vector<int64_t> inputTensorShapeVec = inputTypeInfo.GetTensorTypeAndShapeInfo().GetShape();
-        isDynamicInputShape = (inputTensorShapeVec.size() >= 4) && (inputTensorShapeVec[2] == -1 &&
-                                                                    inputTensorShapeVec[3] ==
-                                                                    -1); // Check for dynamic dimensions
-
-        // Allocate and store input node names
-        auto input_name = session.GetInputNameAllocated(0, allocator);
-        inputNodeNameAllocatedStrings.push_back(std::move(input_name));
-        inputNames.push_back(inputNodeNameAllocatedStrings.back().get());
-
-        // Allocate and store output node names
-        auto output_name = session.GetOutputNameAllocated(0, allocator);
-        outputNodeNameAllocatedStrings.push_back(std::move(output_name));
-        outputNames.push_back(outputNodeNameAllocatedStrings.back().get());
-
-        // Set the expected input image shape based on the model's input tensor
-        if (inputTensorShapeVec.size() >= 4) {
-            inputImageShape = cv::Size(static_cast<int>(inputTensorShapeVec[3]),
-                                       static_cast<int>(inputTensorShapeVec[2]));
-        } else {
-            m_netLoaded = true;
-            throw ObjectDetectorInitializationError("Invalid input tensor shape.");
+/**
+ * @return Size of the input tensor a region of this size is letterboxed to.
+ */
+    cv::Size YOLO11Classifier::inputSizeFor(const cv::Size &regionSize) const {
+        if (!m_session->isDynamicInputShape)
+            return m_session->inputImageShape;
+
+        if (!m_sizeBucketing)
+            return cv::Size(kDefaultInputSize, kDefaultInputSize);
+
+        const int longSide = std::max(regionSize.width, regionSize.height);
+        for (const int bucket: kSizeBuckets) {
+            if (longSide <= bucket)
+                return cv::Size(bucket, bucket);
         }
-
-        // Get the number of input and output nodes
-        numInputNodes = session.GetInputCount();
-        numOutputNodes = session.GetOutputCount();
-        std::cout << "Classification model loaded successfully with " << numInputNodes << " input nodes and "
-                  << numOutputNodes
-                  << " output nodes." << std::endl;
+        return cv::Size(kSizeBuckets[std::size(kSizeBuckets) - 1], kSizeBuckets[std::size(kSizeBuckets) - 1]);
     }
 
 // Preprocess function implementation
-    cv::Mat
-    YOLO11Classifier::preprocess(const cv::Mat &image, float *&blob, std::vector<int64_t> &inputTensorShape) {
-        cv::Mat resizedImage;
-        // Resize and pad the image using letterBox utility
-        letterBox(image, resizedImage, inputImageShape, cv::Scalar(114, 114, 114), isDynamicInputShape,
-                  false, true,
-                  32);
-        // Update input tensor shape based on resized image dimensions
-        inputTensorShape[2] = resizedImage.rows;
-        inputTensorShape[3] = resizedImage.cols;
-
-        // Convert image to float and normalize to [0, 1]
-        resizedImage.convertTo(resizedImage, CV_32FC3, 1 / 255.0f);
-
-        // Allocate memory for the image blob in CHW format
-        blob = new float[resizedImage.cols * resizedImage.rows * resizedImage.channels()];
-
-        // Split the image into separate channels and store in the blob
-        std::vector<cv::Mat> chw(resizedImage.channels());
-        for (int i = 0; i < resizedImage.channels(); ++i) {
-            chw[2 - i] = cv::Mat(resizedImage.rows, resizedImage.cols, CV_32FC1,
-                             blob + i * resizedImage.cols * resizedImage.rows);
-        }
-        cv::split(resizedImage, chw); // Split channels into the blob
-
-        return resizedImage;
+    void YOLO11Classifier::preprocess(
+            const cv::Mat &frame,
+            const cv::Rect &region,
+            const cv::Size &inputSize,
+            float *blob) {
+        // Crop, resize, pad, normalize to [0, 1] and convert to RGB CHW in one pass, reading the
+        // rows of the region straight from the frame
+        const LetterboxGeometry &geometry = m_preprocessor.geometry(region.size(), inputSize, /*autoPad*/ false);
+        m_preprocessor.run(frame.ptr<uint8_t>(region.y) + 3 * (size_t) region.x, frame.step,
+                           geometry, /*swapRB*/ true, blob);
     }
 
 // Postprocess function to convert raw model output into detections
-    std::string YOLO11Classifier::postprocess(
+    Classification YOLO11Classifier::postprocess(
             const cv::Size &originalImageSize,
             const cv::Size &resizedImageShape,
-            const std::vector<Ort::Value> &outputTensors,
+            const float *rawOutput,
+            const std::vector<int64_t> &outputShape,
             float confThreshold,
             float iouThreshold
     ) {
-        const float *rawOutput = outputTensors[0].GetTensorData<float>(); // Extract raw output data from the first output tensor
-        const std::vector<int64_t> outputShape = outputTensors[0].GetTensorTypeAndShapeInfo().GetShape();
-
         // Determine the number of features and detections
         const size_t num_features = outputShape[1];
         const size_t num_detections = outputShape[2];
 
         // Early exit if no detections
         if (num_detections == 0) {
-            return "Unknown";
+            return {};
         }
 
         // Calculate number of classes based on output shape
         const int numClasses = static_cast<int>(num_features) - 4;
         if (numClasses <= 0) {
             // Invalid number of classes
-            return "Unknown";
+            return {};
         }
 
-        // Reserve memory for efficient appending
-        std::vector<cv::Rect> boxes;
-        boxes.reserve(num_detections);
-        std::vector<float> confs;
-        confs.reserve(num_detections);
-        std::vector<int> classIds;
-        classIds.reserve(num_detections);
-        std::vector<cv::Rect> nms_boxes;
-        nms_boxes.reserve(num_detections);
-
-        // Constants for indexing
+        // Find the anchors whose best class passes the threshold, before doing any box math
+        const std::vector<YoloCandidate> &candidates = m_decoder.findCandidates(
+                rawOutput + 4 * num_detections, num_detections, numClasses, confThreshold);
+
+        // Collect the candidate boxes in model input coordinates; only the label is reported, so
+        // the boxes are never scaled to the crop.
+        m_nmsBoxes.clear();
+        m_nmsBoxes.reserve(candidates.size());
         const float *ptr = rawOutput;
+        for (const YoloCandidate &candidate: candidates) {
+            const size_t d = (size_t) candidate.anchor;
 
-        for (size_t d = 0; d < num_detections; ++d) {
             // Extract bounding box coordinates (center x, center y, width, height)
-            float centerX = ptr[0 * num_detections + d];
-            float centerY = ptr[1 * num_detections + d];
-            float width = ptr[2 * num_detections + d];
-            float height = ptr[3 * num_detections + d];
-
-            // Find class with the highest confidence score
-            int classId = -1;
-            float maxScore = -FLT_MAX;
-            for (int c = 0; c < numClasses; ++c) {
-                const float score = ptr[d + (4 + c) * num_detections];
-                if (score > maxScore) {
-                    maxScore = score;
-                    classId = c;
-                }
-            }
+            const float centerX = ptr[0 * num_detections + d];
+            const float centerY = ptr[1 * num_detections + d];
+            const float halfWidth = ptr[2 * num_detections + d] / 2.0f;
+            const float halfHeight = ptr[3 * num_detections + d] / 2.0f;
 
-            // Proceed only if confidence exceeds threshold
-            if (maxScore > confThreshold) {
-                // Convert center coordinates to top-left (x1, y1)
-                float left = centerX - width / 2.0f;
-                float top = centerY - height / 2.0f;
-
-                // Scale to original image size
-                cv::Rect scaledBox = scaleCoords(
-                        resizedImageShape,
-                        cv::Rect(left, top, width, height),
-                        originalImageSize,
-                        true
-                );
-
-                // Round coordinates for integer pixel positions
-                cv::Rect roundedBox;
-                roundedBox.x = std::round(scaledBox.x);
-                roundedBox.y = std::round(scaledBox.y);
-                roundedBox.width = std::round(scaledBox.width);
-                roundedBox.height = std::round(scaledBox.height);
-
-                // Adjust NMS box coordinates to prevent overlap between classes
-                cv::Rect nmsBox = roundedBox;
-                nmsBox.x += classId * 7680; // Arbitrary offset to differentiate classes
-                nmsBox.y += classId * 7680;
-
-                // Add to respective containers
-                nms_boxes.emplace_back(nmsBox);
-                boxes.emplace_back(roundedBox);
-                confs.emplace_back(maxScore);
-                classIds.emplace_back(classId);
-            }
+            m_nmsBoxes.push_back(centerX - halfWidth, centerY - halfHeight, centerX + halfWidth,
+                                 centerY + halfHeight, candidate.score, candidate.classId);
         }
 
         // Apply Non-Maximum Suppression (NMS) to eliminate redundant detections
-        std::vector<int> indices;
-        NMSBoxes(nms_boxes, confs, confThreshold, iouThreshold, indices);
+        const std::vector<int32_t> &indices = m_nms.run(m_nmsBoxes, iouThreshold);
 
+        // The indices are sorted by score, so the first one is the most confident class.
         if (!indices.empty()) {
-            const std::string classLabel = kClassesToClassification[(size_t) classIds[0]];
-            return classLabel;
+            const size_t best = (size_t) indices[0];
+            return {m_nmsBoxes.classIds[best], m_nmsBoxes.scores[best]};
         }
 
-        return "Unknown";
+        return {};
     }
 
-    std::string YOLO11Classifier::runImpl(const cv::Mat &frame) {
+    std::pmr::vector<Classification> YOLO11Classifier::runImpl(
+            const cv::Mat &frame,
+            const std::vector<cv::Rect> &regions,
+            std::pmr::memory_resource *memory) {
         if (isTerminated()) {
             throw ObjectDetectorIsTerminatedError(
                     "Object detection error: object detector is terminated.");
         }
 
-        float *blobPtr = nullptr; // Pointer to hold preprocessed image data
+        CV_Assert(frame.type() == CV_8UC3);
+        std::pmr::vector<Classification> classifications(regions.size(), memory);
+
+        // Group the regions by the input size they are letterboxed to, so that every group can be
+        // run as one batch.
+        const cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+        m_regions.resize(regions.size());
+        std::pmr::map<std::pair<int, int>, std::pmr::vector<size_t>> regionIndicesBySize(memory);
+        for (size_t i = 0; i < regions.size(); ++i) {
+            m_regions[i] = regions[i] & frameRect;
+            if (m_regions[i].empty())
+                continue;
+            const cv::Size inputSize = inputSizeFor(m_regions[i].size());
+            regionIndicesBySize[{inputSize.width, inputSize.height}].push_back(i);
+        }
+
+        for (const auto &[size, regionIndices]: regionIndicesBySize) {
+            // Models with a fixed batch dimension can only classify one region per call; the
+            // others as many as fit into kMaxBatchPixels.
+            const size_t maxBatchSize = m_session->isDynamicBatchSize
+                                        ? std::clamp<size_t>(kMaxBatchPixels / ((size_t) size.first * size.second),
+                                                             1, kMaxBatchSize)
+                                        : 1;
+            for (size_t begin = 0; begin < regionIndices.size(); begin += maxBatchSize) {
+                const size_t end = std::min(regionIndices.size(), begin + maxBatchSize);
+                m_batchRegionIndices.assign(regionIndices.begin() + begin, regionIndices.begin() + end);
+                classifyBatch(frame, m_batchRegionIndices, cv::Size(size.first, size.second), &classifications);
+            }
+        }
+
+        return classifications;
+    }
+
+    void YOLO11Classifier::classifyBatch(
+            const cv::Mat &frame,
+            const std::vector<size_t> &regionIndices,
+            const cv::Size &inputSize,
+            std::pmr::vector<Classification> *outClassifications) {
         // Define the shape of the input tensor (batch size, channels, height, width)
-        std::vector<int64_t> inputTensorShape = {1, 3, inputImageShape.height, inputImageShape.width};
-
-        // Preprocess the image and obtain a pointer to the blob
-        cv::Mat preprocessedImage = preprocess(frame, blobPtr, inputTensorShape);
-        // Compute the total number of elements in the input tensor
-        size_t inputTensorSize = vectorProduct(inputTensorShape);
-
-        // Create a vector from the blob data for ONNX Runtime input
-        std::vector<float> inputTensorValues(blobPtr, blobPtr + inputTensorSize);
-
-        delete[] blobPtr; // Free the allocated memory for the blob
-
-        // Create an Ort memory info object (can be cached if used repeatedly)
-        static Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-
-        // Create input tensor object using the preprocessed data
-        Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
-                memoryInfo,
-                inputTensorValues.data(),
-                inputTensorSize,
-                inputTensorShape.data(),
-                inputTensorShape.size()
-        );
-
-        // Run the inference session with the input tensor and retrieve output tensors
-        std::vector<Ort::Value> outputTensors = session.Run(
-                Ort::RunOptions{nullptr},
-                inputNames.data(),
-                &inputTensor,
-                numInputNodes,
-                outputNames.data(),
-                numOutputNodes
-        );
-
-        // Determine the resized image shape based on input tensor shape
-        cv::Size resizedImageShape(static_cast<int>(inputTensorShape[3]),
-                                   static_cast<int>(inputTensorShape[2]));
-
-        // Postprocess the output tensors to obtain detections
-        std::string classLabel = postprocess(frame.size(), resizedImageShape, outputTensors);
-//        NX_PRINT << "Class label is " << classLabel;
-        return classLabel;
+        const std::vector<int64_t> inputTensorShape = {
+                (int64_t) regionIndices.size(), 3, inputSize.height, inputSize.width};
+        const size_t imageTensorSize = 3 * (size_t) inputSize.area();
+
+        // Preprocess every region straight into its slot of the bound input buffer
+        float *const inputTensorValues = m_boundSession->input(inputTensorShape);
+        for (size_t i = 0; i < regionIndices.size(); ++i)
+            preprocess(frame, m_regions[regionIndices[i]], inputSize, inputTensorValues + i * imageTensorSize);
+
+        // Run the inference session on the bound buffers; the output is written in place
+        m_boundSession->run();
+
+        const float *rawOutput = m_boundSession->output();
+        const std::vector<int64_t> &outputShape = m_boundSession->outputShape();
+        const size_t outputSize = vectorProduct(outputShape) / regionIndices.size();
+
+        // Postprocess the part of the output which belongs to each region
+        for (size_t i = 0; i < regionIndices.size(); ++i) {
+            const size_t regionIndex = regionIndices[i];
+            (*outClassifications)[regionIndex] = postprocess(
+                    m_regions[regionIndex].size(), inputSize, rawOutput + i * outputSize, outputShape);
+        }
     }
-}
\ No newline at end of file
+}
@@ -10,8 +10,18 @@ namespace nx_meta_plugin {
     using namespace std::string_literals;
     using namespace cv;
 
-    YOLO11Detector::YOLO11Detector(std::filesystem::path modelDir) :
-            m_modelDir(std::move(modelDir)) {
+    /** Input sizes of the model must be multiples of this. */
+    static constexpr int kModelStride = 32;
+
+    YOLO11Detector::YOLO11Detector(
+            std::filesystem::path modelDir,
+            std::shared_ptr<ModelRegistry> modelRegistry,
+            std::shared_ptr<InferenceScheduler> inferenceScheduler,
+            const ModelOptions &modelOptions) :
+            m_modelDir(std::move(modelDir)),
+            m_modelOptions(modelOptions),
+            m_modelRegistry(std::move(modelRegistry)),
+            m_inferenceScheduler(std::move(inferenceScheduler)) {
     }
 
 /**
@@ -47,12 +57,15 @@ namespace nx_meta_plugin {
         m_terminated = true;
     }
 
-    DetectionList YOLO11Detector::run(const cv::Mat &frame) {
+    void YOLO11Detector::run(
+            const cv::Mat &frame,
+            const std::vector<cv::Rect> &regions,
+            DetectionBatch *outDetections) {
         if (isTerminated())
             throw ObjectDetectorIsTerminatedError("Detection error: object detector is terminated.");
 
         try {
-            return runImpl(frame);
+            runImpl(frame, regions, outDetections);
         }
         catch (const cv::Exception &e) {
             terminate();
@@ -65,277 +78,244 @@ namespace nx_meta_plugin {
     }
 
     void YOLO11Detector::loadModel() {
-        // Initialize ONNX Runtime environment with warning level
-        env = Ort::Env(ORT_LOGGING_LEVEL_WARNING, "ONNX_DETECTION");
-        sessionOptions = Ort::SessionOptions();
-
-        // Set number of intra-op threads for parallelism
-        sessionOptions.SetIntraOpNumThreads(std::min(6, static_cast<int>(std::thread::hardware_concurrency())));
-        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-
-        // Retrieve available execution providers (e.g., CPU, CUDA)
-        std::vector<std::string> availableProviders = Ort::GetAvailableProviders();
-        auto cudaAvailable = std::find(availableProviders.begin(), availableProviders.end(),
-                                       "CUDAExecutionProvider");
-        OrtCUDAProviderOptions cudaOption;
-
-        // Configure session options based on whether GPU is to be used and available
-        if (useGPU && cudaAvailable != availableProviders.end()) {
-            std::cout << "Inference device: GPU" << std::endl;
-            sessionOptions.AppendExecutionProvider_CUDA(cudaOption); // Append CUDA execution provider
-        } else {
-            if (useGPU) {
-                std::cout << "GPU is not supported by your ONNXRuntime build. Fallback to CPU." << std::endl;
-            }
-            std::cout << "Inference device: CPU" << std::endl;
-        }
-
-        // Load the ONNX model into the session
-        std::filesystem::path modelPath = m_modelDir / std::filesystem::path("yolov11n.onnx");
-        std::string modelPathStr{modelPath.u8string()};
-        std::cout << "Detection model path: " << modelPathStr << std::endl;
-#ifdef _WIN32
-        std::wstring w_modelPath(modelPathStr.begin(), m_modelPath.end());
-        session = Ort::Session(env, w_modelPath.c_str(), sessionOptions);
-#else
-        session = Ort::Session(env, modelPathStr.c_str(), sessionOptions);
-#endif
-
-        Ort::AllocatorWithDefaultOptions allocator;
-
-        // Retrieve input tensor shape information
-        Ort::TypeInfo inputTypeInfo = session.GetInputTypeInfo(0);
-        std::vector<int64_t> inputTensorShapeVec = inputTypeInfo.GetTensorTypeAndShapeInfo().GetShape();
-        isDynamicInputShape = (inputTensorShapeVec.size() >= 4) && (inputTensorShapeVec[2] == -1 &&
-                                                                    inputTensorShapeVec[3] ==
-                                                                    -1); // Check for dynamic dimensions
-
-        // Allocate and store input node names
-        auto input_name = session.GetInputNameAllocated(0, allocator);
-        inputNodeNameAllocatedStrings.push_back(std::move(input_name));
-        inputNames.push_back(inputNodeNameAllocatedStrings.back().get());
-
-        // Allocate and store output node names
-        auto output_name = session.GetOutputNameAllocated(0, allocator);
-        outputNodeNameAllocatedStrings.push_back(std::move(output_name));
-        outputNames.push_back(outputNodeNameAllocatedStrings.back().get());
-
-        // Set the expected input image shape based on the model's input tensor
-        if (inputTensorShapeVec.size() >= 4) {
-            inputImageShape = cv::Size(static_cast<int>(inputTensorShapeVec[3]),
-                                       static_cast<int>(inputTensorShapeVec[2]));
-        } else {
-            m_netLoaded = true;
-            throw ObjectDetectorInitializationError("Invalid input tensor shape.");
-        }
-
-        // Get the number of input and output nodes
-        numInputNodes = session.GetInputCount();
-        numOutputNodes = session.GetOutputCount();
-        std::cout << "Detection model loaded successfully with " << numInputNodes << " input nodes and "
-                  << numOutputNodes
-                  << " output nodes." << std::endl;
+        // The session is shared with all other DeviceAgents which use the same model.
+        ModelOptions options = m_modelOptions;
+        options.useGpu = useGPU;
+        m_session = m_modelRegistry->acquire(
+                m_modelDir / std::filesystem::path("yolov11n.onnx"), options);
+        m_boundSession = std::make_unique<BoundSession>(m_session.get());
+
+        m_netLoaded = true;
     }
 
-// Preprocess function implementation
-    cv::Mat
-    YOLO11Detector::preprocess(const cv::Mat &image, float *&blob, std::vector<int64_t> &inputTensorShape) {
-        cv::Mat resizedImage;
-        // Resize and pad the image using letterBox utility
-        letterBox(image, resizedImage, inputImageShape, cv::Scalar(114, 114, 114), isDynamicInputShape,
-                  false, true,
-                  32);
+/**
+ * Set the spatial dimensions of inputTensorShape to the size the frame is letterboxed to.
+ *
+ * @return Letterbox geometry of the frame.
+ */
+    const LetterboxGeometry &YOLO11Detector::inputGeometry(
+            const cv::Mat &image,
+            std::vector<int64_t> &inputTensorShape) {
+        // The geometry is computed once per camera resolution.
+        const LetterboxGeometry &geometry = m_preprocessor.geometry(
+                image.size(), m_session->inputImageShape, m_session->isDynamicInputShape);
 
         // Update input tensor shape based on resized image dimensions
-        inputTensorShape[2] = resizedImage.rows;
-        inputTensorShape[3] = resizedImage.cols;
-
-        // Convert image to float and normalize to [0, 1]
-        resizedImage.convertTo(resizedImage, CV_32FC3, 1 / 255.0f);
-
-        // Allocate memory for the image blob in CHW format
-        blob = new float[resizedImage.cols * resizedImage.rows * resizedImage.channels()];
-
-        // Split the image into separate channels and store in the blob
-        std::vector<cv::Mat> chw(resizedImage.channels());
-        for (int i = 0; i < resizedImage.channels(); ++i) {
-            chw[i] = cv::Mat(resizedImage.rows, resizedImage.cols, CV_32FC1,
-                             blob + i * resizedImage.cols * resizedImage.rows);
-        }
-        cv::split(resizedImage, chw); // Split channels into the blob
+        inputTensorShape[2] = geometry.outputSize.height;
+        inputTensorShape[3] = geometry.outputSize.width;
+        return geometry;
+    }
 
-        return resizedImage;
+/**
+ * Letterbox the frame straight into the input buffer bound to the session, and set the spatial
+ * dimensions of inputTensorShape to the size of the letterboxed image.
+ */
+    void YOLO11Detector::preprocess(const cv::Mat &image, std::vector<int64_t> &inputTensorShape) {
+        const LetterboxGeometry &geometry = inputGeometry(image, inputTensorShape);
+
+        // Resize, pad, normalize to [0, 1] and convert to CHW in one pass
+        float *const inputTensorValues = m_boundSession->input(inputTensorShape);
+        m_preprocessor.run(image, geometry, /*swapRB*/ false, inputTensorValues);
     }
 
-// Postprocess function to convert raw model output into detections
-    DetectionList YOLO11Detector::postprocess(
-            const cv::Size &originalImageSize,
+/**
+ * Decode the raw model output of one image and append the candidate boxes to m_nmsBoxes, in the
+ * coordinates of the frame the image was cut from.
+ *
+ * @param region Part of the frame which was letterboxed into the model input.
+ */
+    void YOLO11Detector::appendCandidates(
+            const cv::Rect &region,
             const cv::Size &resizedImageShape,
-            const std::vector<Ort::Value> &outputTensors,
-            float confThreshold,
-            float iouThreshold
+            const float *rawOutput,
+            const std::vector<int64_t> &outputShape,
+            float confThreshold
     ) {
-        DetectionList detections;
-        const float *rawOutput = outputTensors[0].GetTensorData<float>(); // Extract raw output data from the first output tensor
-        const std::vector<int64_t> outputShape = outputTensors[0].GetTensorTypeAndShapeInfo().GetShape();
-
         // Determine the number of features and detections
         const size_t num_features = outputShape[1];
         const size_t num_detections = outputShape[2];
 
         // Early exit if no detections
         if (num_detections == 0) {
-            return detections;
+            return;
         }
 
         // Calculate number of classes based on output shape
         const int numClasses = static_cast<int>(num_features) - 4;
         if (numClasses <= 0) {
             // Invalid number of classes
-            return detections;
+            return;
         }
 
-        // Reserve memory for efficient appending
-        std::vector<cv::Rect> boxes;
-        boxes.reserve(num_detections);
-        std::vector<float> confs;
-        confs.reserve(num_detections);
-        std::vector<int> classIds;
-        classIds.reserve(num_detections);
-        std::vector<cv::Rect> nms_boxes;
-        nms_boxes.reserve(num_detections);
-
-        // Constants for indexing
+        // Find the anchors whose best class passes the threshold, before doing any box math
+        const std::vector<YoloCandidate> &candidates = m_decoder.findCandidates(
+                rawOutput + 4 * num_detections, num_detections, numClasses, confThreshold);
+
+        // Classes are kept apart by the NMS buckets, so no coordinate offsets are needed.
+        m_nmsBoxes.reserve(m_nmsBoxes.size() + candidates.size());
         const float *ptr = rawOutput;
+        for (const YoloCandidate &candidate: candidates) {
+            const size_t d = (size_t) candidate.anchor;
 
-        for (size_t d = 0; d < num_detections; ++d) {
             // Extract bounding box coordinates (center x, center y, width, height)
-            float centerX = ptr[0 * num_detections + d];
-            float centerY = ptr[1 * num_detections + d];
-            float width = ptr[2 * num_detections + d];
-            float height = ptr[3 * num_detections + d];
-
-            // Find class with the highest confidence score
-            int classId = -1;
-            float maxScore = -FLT_MAX;
-            for (int c = 0; c < numClasses; ++c) {
-                const float score = ptr[d + (4 + c) * num_detections];
-                if (score > maxScore) {
-                    maxScore = score;
-                    classId = c;
-                }
-            }
-
-            // Proceed only if confidence exceeds threshold
-            if (maxScore > confThreshold) {
-                // Convert center coordinates to top-left (x1, y1)
-                float left = centerX - width / 2.0f;
-                float top = centerY - height / 2.0f;
-
-                // Scale to original image size
-                cv::Rect scaledBox = scaleCoords(
-                        resizedImageShape,
-                        cv::Rect(left, top, width, height),
-                        originalImageSize,
-                        true
-                );
-
-                // Round coordinates for integer pixel positions
-                cv::Rect roundedBox;
-                roundedBox.x = std::round(scaledBox.x);
-                roundedBox.y = std::round(scaledBox.y);
-                roundedBox.width = std::round(scaledBox.width);
-                roundedBox.height = std::round(scaledBox.height);
-
-                // Adjust NMS box coordinates to prevent overlap between classes
-                cv::Rect nmsBox = roundedBox;
-                nmsBox.x += classId * 7680; // Arbitrary offset to differentiate classes
-                nmsBox.y += classId * 7680;
-
-                // Add to respective containers
-                nms_boxes.emplace_back(nmsBox);
-                boxes.emplace_back(roundedBox);
-                confs.emplace_back(maxScore);
-                classIds.emplace_back(classId);
-            }
+            const float centerX = ptr[0 * num_detections + d];
+            const float centerY = ptr[1 * num_detections + d];
+            const float width = ptr[2 * num_detections + d];
+            const float height = ptr[3 * num_detections + d];
+
+            // Scale to the region, then move to the frame
+            const cv::Rect scaledBox = scaleCoords(
+                    resizedImageShape,
+                    cv::Rect(centerX - width / 2.0f, centerY - height / 2.0f, width, height),
+                    region.size(),
+                    true
+            );
+
+            const float left = (float) (region.x + scaledBox.x);
+            const float top = (float) (region.y + scaledBox.y);
+            m_nmsBoxes.push_back(left, top, left + (float) scaledBox.width, top + (float) scaledBox.height,
+                                 candidate.score, candidate.classId);
         }
+    }
 
+/**
+ * Run NMS over the candidates of all the images of the frame, which merges the detections of an
+ * object seen by several overlapping regions, and convert the kept ones to detections.
+ */
+    void YOLO11Detector::postprocess(DetectionBatch *outDetections, float iouThreshold) {
         // Apply Non-Maximum Suppression (NMS) to eliminate redundant detections
-        std::vector<int> indices;
-        NMSBoxes(nms_boxes, confs, confThreshold, iouThreshold, indices);
-
-        // Collect filtered detections into the result vector
-        detections.reserve(indices.size());
-        for (const int idx: indices) {
-            const std::string classLabel = kClasses[(size_t) classIds[idx]];
-            bool oneOfRequiredClasses = std::find(
-                    kClassesToDetect.begin(), kClassesToDetect.end(), classLabel) != kClassesToDetect.end();
-            if (oneOfRequiredClasses) {
-                detections.emplace_back(std::make_shared<Detection>(
-                        Detection{
-                                cvRectToNxRect(boxes[idx], originalImageSize.width, originalImageSize.height),
-                                kClasses[(size_t) classIds[idx]],
-                                confs[idx],
-                                nx::sdk::Uuid() //< Will be filled with real value in ObjectTracker.
-                                // nx::sdk::UuidHelper::randomUuid()
-                        }
-                ));
-            }
+        const std::vector<int32_t> &indices = m_nms.run(m_nmsBoxes, iouThreshold);
+
+        // The decoder has already dropped the classes which are not reported.
+        outDetections->clear();
+        outDetections->reserve(indices.size());
+        for (const int32_t idx: indices) {
+            const size_t i = (size_t) idx;
+            outDetections->push_back(
+                    cv::Rect(
+                            (int) m_nmsBoxes.x1[i],
+                            (int) m_nmsBoxes.y1[i],
+                            (int) (m_nmsBoxes.x2[i] - m_nmsBoxes.x1[i]),
+                            (int) (m_nmsBoxes.y2[i] - m_nmsBoxes.y1[i])),
+                    m_nmsBoxes.classIds[i],
+                    m_nmsBoxes.scores[i]);
+        }
+    }
+
+/**
+ * @return Input size shared by all the regions of a batch: the largest region scaled down to fit
+ *     the model input, rounded up to the model stride. Smaller regions are not scaled up to the
+ *     full model input, so that they cost fewer pixels; models with a fixed input shape take only
+ *     that shape.
+ */
+    cv::Size YOLO11Detector::regionInputSize(const std::vector<cv::Rect> &regions) const {
+        const cv::Size &inputImageShape = m_session->inputImageShape;
+        if (!m_session->isDynamicInputShape)
+            return inputImageShape;
+
+        cv::Size result(kModelStride, kModelStride);
+        for (const cv::Rect &region: regions) {
+            const float ratio = std::min({1.0f,
+                                          (float) inputImageShape.width / region.width,
+                                          (float) inputImageShape.height / region.height});
+            result.width = std::max(result.width, (int) std::round(region.width * ratio));
+            result.height = std::max(result.height, (int) std::round(region.height * ratio));
         }
+        result.width = std::min(inputImageShape.width, (result.width + kModelStride - 1) / kModelStride * kModelStride);
+        result.height = std::min(inputImageShape.height, (result.height + kModelStride - 1) / kModelStride * kModelStride);
+        return result;
+    }
 
-        return detections;
+/**
+ * Letterbox every region into its slot of the bound input and run them in batches, appending the
+ * candidates of every region to m_nmsBoxes.
+ */
+    void YOLO11Detector::detectRegions(const cv::Mat &frame, const std::vector<cv::Rect> &regions) {
+        const cv::Size resizedImageShape = regionInputSize(regions);
+        const size_t imageTensorSize = 3 * (size_t) resizedImageShape.area();
+
+        // Models with a fixed batch dimension can only run one region per call; the others as many
+        // as fit into kMaxBatchPixels.
+        const size_t maxBatchSize = m_session->isDynamicBatchSize
+                                    ? std::clamp<size_t>(kMaxBatchPixels / (size_t) resizedImageShape.area(),
+                                                         1, kMaxBatchSize)
+                                    : 1;
+        for (size_t begin = 0; begin < regions.size(); begin += maxBatchSize) {
+            const size_t batchSize = std::min(maxBatchSize, regions.size() - begin);
+            const std::vector<int64_t> inputTensorShape = {
+                    (int64_t) batchSize, 3, resizedImageShape.height, resizedImageShape.width};
+
+            float *const inputTensorValues = m_boundSession->input(inputTensorShape);
+            for (size_t i = 0; i < batchSize; ++i) {
+                const cv::Rect &region = regions[begin + i];
+                const LetterboxGeometry &geometry = m_preprocessor.geometry(
+                        region.size(), resizedImageShape, /*autoPad*/ false, kModelStride);
+                m_preprocessor.run(frame(region), geometry, /*swapRB*/ false,
+                                   inputTensorValues + i * imageTensorSize);
+            }
+
+            m_boundSession->run();
+
+            // Postprocess the part of the output which belongs to each region
+            const float *rawOutput = m_boundSession->output();
+            const std::vector<int64_t> &outputShape = m_boundSession->outputShape();
+            const size_t outputSize = vectorProduct(outputShape) / batchSize;
+            for (size_t i = 0; i < batchSize; ++i) {
+                appendCandidates(regions[begin + i], resizedImageShape, rawOutput + i * outputSize, outputShape);
+            }
+        }
     }
 
-    DetectionList YOLO11Detector::runImpl(const cv::Mat &frame) {
+    void YOLO11Detector::runImpl(
+            const cv::Mat &frame,
+            const std::vector<cv::Rect> &regions,
+            DetectionBatch *outDetections) {
         if (isTerminated()) {
             throw ObjectDetectorIsTerminatedError(
                     "Object detection error: object detector is terminated.");
         }
 
-        float *blobPtr = nullptr; // Pointer to hold preprocessed image data
+        m_nmsBoxes.clear();
+        if (!regions.empty()) {
+            // The regions are one batch already, so they are not merged with the frames of other
+            // cameras by the scheduler.
+            detectRegions(frame, regions);
+            postprocess(outDetections);
+            return;
+        }
+
         // Define the shape of the input tensor (batch size, channels, height, width)
+        const cv::Size &inputImageShape = m_session->inputImageShape;
         std::vector<int64_t> inputTensorShape = {1, 3, inputImageShape.height, inputImageShape.width};
 
-        // Preprocess the image and obtain a pointer to the blob
-        cv::Mat preprocessedImage = preprocess(frame, blobPtr, inputTensorShape);
-
-        // Compute the total number of elements in the input tensor
-        size_t inputTensorSize = vectorProduct(inputTensorShape);
-
-        // Create a vector from the blob data for ONNX Runtime input
-        std::vector<float> inputTensorValues(blobPtr, blobPtr + inputTensorSize);
-
-        delete[] blobPtr; // Free the allocated memory for the blob
-
-        // Create an Ort memory info object (can be cached if used repeatedly)
-        static Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-
-        // Create input tensor object using the preprocessed data
-        Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
-                memoryInfo,
-                inputTensorValues.data(),
-                inputTensorSize,
-                inputTensorShape.data(),
-                inputTensorShape.size()
-        );
-
-        // Run the inference session with the input tensor and retrieve output tensors
-        std::vector<Ort::Value> outputTensors = session.Run(
-                Ort::RunOptions{nullptr},
-                inputNames.data(),
-                &inputTensor,
-                numInputNodes,
-                outputNames.data(),
-                numOutputNodes
-        );
-
-        // Determine the resized image shape based on input tensor shape
-        cv::Size resizedImageShape(static_cast<int>(inputTensorShape[3]),
-                                   static_cast<int>(inputTensorShape[2]));
+        const cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+        if (m_inferenceScheduler && m_inferenceScheduler->isBatchingEnabled(*m_session)) {
+            // Let the Engine run this frame in one batch together with the frames of other
+            // cameras: the frame is letterboxed straight into its slot of the batch input, and
+            // decoded straight from its slot of the batch output.
+            const LetterboxGeometry &geometry = inputGeometry(frame, inputTensorShape);
+            m_inferenceScheduler->run(
+                    m_session,
+                    inputTensorShape,
+                    [&](float *input) {
+                        m_preprocessor.run(frame, geometry, /*swapRB*/ false, input);
+                    },
+                    [&](const float *output, const std::vector<int64_t> &outputShape) {
+                        appendCandidates(frameRect, geometry.outputSize, output, outputShape);
+                    });
+        } else {
+            // Preprocess the image into the persistent input buffer, and run the inference session
+            // on the bound buffers; the output is written in place
+            preprocess(frame, inputTensorShape);
+            m_boundSession->run();
+
+            // Determine the resized image shape based on input tensor shape
+            const cv::Size resizedImageShape(static_cast<int>(inputTensorShape[3]),
+                                             static_cast<int>(inputTensorShape[2]));
+            appendCandidates(frameRect, resizedImageShape, m_boundSession->output(), m_boundSession->outputShape());
+        }
 
         // Postprocess the output tensors to obtain detections
-        DetectionList detections = postprocess(frame.size(), resizedImageShape, outputTensors);
-        // NX_PRINT << "size of DetectionList " << detections.size();
-        return detections; // Return the vector of detections
+        postprocess(outDetections);
     }
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "yolo_decoder.h"
+
+#include <algorithm>
+
+#include "simd.h"
+
+namespace nx_meta_plugin {
+
+/**
+ * Update the running max and argmax of the anchors with one class row.
+ */
+    static void accumulateClassRow(
+            const float *row,
+            int32_t classId,
+            size_t numAnchors,
+            float *maxScores,
+            int32_t *classIds) {
+        size_t i = 0;
+#if defined(NX_PLUGIN_SIMD_AVX2)
+        const __m256i classIdVector = _mm256_set1_epi32(classId);
+        for (; i + 8 <= numAnchors; i += 8) {
+            const __m256 scores = _mm256_loadu_ps(row + i);
+            const __m256 maxima = _mm256_loadu_ps(maxScores + i);
+            const __m256 greater = _mm256_cmp_ps(scores, maxima, _CMP_GT_OQ);
+            _mm256_storeu_ps(maxScores + i, _mm256_blendv_ps(maxima, scores, greater));
+
+            __m256i *const ids = reinterpret_cast<__m256i *>(classIds + i);
+            _mm256_storeu_si256(ids, _mm256_blendv_epi8(
+                    _mm256_loadu_si256(ids), classIdVector, _mm256_castps_si256(greater)));
+        }
+#elif defined(NX_PLUGIN_SIMD_SSE2)
+        // SSE2 has no blend instructions, so select with and/andnot/or.
+        const __m128i classIdVector = _mm_set1_epi32(classId);
+        for (; i + 4 <= numAnchors; i += 4) {
+            const __m128 scores = _mm_loadu_ps(row + i);
+            const __m128 maxima = _mm_loadu_ps(maxScores + i);
+            const __m128 greater = _mm_cmpgt_ps(scores, maxima);
+            _mm_storeu_ps(maxScores + i,
+                          _mm_or_ps(_mm_and_ps(greater, scores), _mm_andnot_ps(greater, maxima)));
+
+            __m128i *const ids = reinterpret_cast<__m128i *>(classIds + i);
+            const __m128i greaterMask = _mm_castps_si128(greater);
+            _mm_storeu_si128(ids, _mm_or_si128(
+                    _mm_and_si128(greaterMask, classIdVector),
+                    _mm_andnot_si128(greaterMask, _mm_loadu_si128(ids))));
+        }
+#endif
+        for (; i < numAnchors; ++i) {
+            if (row[i] > maxScores[i]) {
+                maxScores[i] = row[i];
+                classIds[i] = classId;
+            }
+        }
+    }
+
+/**
+ * Append the anchors whose score is greater than confThreshold. The class of anchor i is
+ * classIds[i], or classId if classIds is null.
+ */
+    static void appendCandidates(
+            const float *scores,
+            const int32_t *classIds,
+            int32_t classId,
+            size_t numAnchors,
+            float confThreshold,
+            std::vector<YoloCandidate> *outCandidates) {
+        const auto append =
+                [&](size_t anchor) {
+                    outCandidates->push_back(
+                            {(int32_t) anchor, classIds ? classIds[anchor] : classId, scores[anchor]});
+                };
+
+        // Most anchors are below the threshold, so test whole vectors before looking at anchors.
+        size_t i = 0;
+#if defined(NX_PLUGIN_SIMD_AVX2)
+        const __m256 threshold = _mm256_set1_ps(confThreshold);
+        for (; i + 8 <= numAnchors; i += 8) {
+            const int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(scores + i), threshold, _CMP_GT_OQ));
+            for (int lane = 0; mask >> lane; ++lane) {
+                if (mask & (1 << lane))
+                    append(i + lane);
+            }
+        }
+#elif defined(NX_PLUGIN_SIMD_SSE2)
+        const __m128 threshold = _mm_set1_ps(confThreshold);
+        for (; i + 4 <= numAnchors; i += 4) {
+            const int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(scores + i), threshold));
+            for (int lane = 0; mask >> lane; ++lane) {
+                if (mask & (1 << lane))
+                    append(i + lane);
+            }
+        }
+#endif
+        for (; i < numAnchors; ++i) {
+            if (scores[i] > confThreshold)
+                append(i);
+        }
+    }
+
+    YoloDecoder::YoloDecoder(const ClassMask &classes) :
+            m_classes(classes) {
+    }
+
+    const std::vector<YoloCandidate> &YoloDecoder::findCandidates(
+            const float *classScores,
+            size_t numAnchors,
+            int numClasses,
+            float confThreshold) {
+        m_candidates.clear();
+
+        m_classRows.clear();
+        for (int c = 0; c < numClasses; ++c) {
+            if (m_classes.contains(c))
+                m_classRows.push_back(c);
+        }
+        if (numAnchors == 0 || m_classRows.empty())
+            return m_candidates;
+
+        // With a single class there is nothing to take the max over; threshold its row directly.
+        if (m_classRows.size() == 1) {
+            appendCandidates(classScores + (size_t) m_classRows[0] * numAnchors, /*classIds*/ nullptr,
+                             m_classRows[0], numAnchors, confThreshold, &m_candidates);
+            return m_candidates;
+        }
+
+        // The first class row initializes the running maxima.
+        const float *firstRow = classScores + (size_t) m_classRows[0] * numAnchors;
+        m_maxScores.assign(firstRow, firstRow + numAnchors);
+        m_classIds.assign(numAnchors, m_classRows[0]);
+        for (size_t i = 1; i < m_classRows.size(); ++i) {
+            const int32_t c = m_classRows[i];
+            accumulateClassRow(classScores + (size_t) c * numAnchors, c, numAnchors,
+                               m_maxScores.data(), m_classIds.data());
+        }
+
+        appendCandidates(m_maxScores.data(), m_classIds.data(), /*classId*/ 0, numAnchors, confThreshold,
+                         &m_candidates);
+        return m_candidates;
+    }
+
+}
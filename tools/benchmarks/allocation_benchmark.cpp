@@ -0,0 +1,218 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+// Check of the heap allocations of the pipeline in the steady state. A synthetic crowd is replayed
+// through the code of DeviceAgent which needs no model: the frames pass through PipelineChannels
+// and the scene gate, the detections of a stand-in detector are put into the arena of the frame,
+// and TrackingStage tracks them with ByteTracker, labels them through the classification cache and
+// a stand-in classifier, and builds the metadata packet; the track motions are copied back for the
+// next frame, as the detection stage does. After a warm-up, the allocations per frame of every
+// stage are printed and checked against kBudget; the exit code is 1 if any stage is over its
+// budget, so that allocation regressions can be caught by CI. Built only with
+// -DcountAllocations=ON, which makes the allocations counted.
+
+#include <array>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "allocation_counter.h"
+#include "detection.h"
+#include "frame.h"
+#include "frame_memory.h"
+#include "pipeline_channel.h"
+#include "region_classifier.h"
+#include "scene_gate.h"
+#include "tracking_stage.h"
+
+using namespace nx_meta_plugin;
+
+namespace {
+
+    constexpr int kFrameWidth = 1920;
+    constexpr int kFrameHeight = 1080;
+    constexpr int kPersonCount = 40;
+    constexpr int kWarmUpFrameCount = 150;
+    constexpr int kFrameCount = 600;
+    constexpr double kFrameRateHz = 15;
+    constexpr int64_t kClassificationIntervalUs = 2'000'000;
+
+    /**
+     * Allocations per frame allowed in each stage, indexed by AllocationStage. The reused buffers
+     * grow now and then, when there are more tracks than ever before. The tracked objects are kept
+     * in std::deque (the cv::tbm container), which frees its blocks when cleared; the tracks new to
+     * the classification cache get an entry. The metadata packet is new on every frame, and grows
+     * its list of objects; the tracks new to the metadata builder get their objects and TrackID
+     * attributes.
+     */
+    constexpr AllocationCounts kBudget{
+            /*other*/ 0,
+            /*detection*/ 1,
+            /*tracking*/ 10,
+            /*classification*/ 1,
+            /*metadata*/ 10,
+    };
+
+    struct Person {
+        cv::Point2f position;
+        cv::Point2f velocity; /**< Pixels per frame. */
+        cv::Size size;
+    };
+
+    /** Frame on its way through the pipeline, like the ones of DeviceAgent. */
+    struct QueuedFrame {
+        int64_t index = 0;
+        FrameMemory *memory = nullptr;
+    };
+
+    /** Stand-in for the detector: the people, jittered, with a few missed and false positives. */
+    class SyntheticDetector {
+    public:
+        SyntheticDetector() {
+            std::uniform_real_distribution<float> speed(-4, 4);
+            for (Person &person: m_people) {
+                const int width = 30 + (int) (m_unit(m_random) * 40);
+                person.size = cv::Size(width, 5 * width / 2);
+                person.position = cv::Point2f(
+                        m_unit(m_random) * (float) (kFrameWidth - person.size.width),
+                        m_unit(m_random) * (float) (kFrameHeight - person.size.height));
+                person.velocity = cv::Point2f(speed(m_random), speed(m_random) / 2);
+            }
+        }
+
+        /** Draw the people as they are now, so that the scene gate sees them move. */
+        void draw(cv::Mat *image) const {
+            image->setTo(cv::Scalar(96, 96, 96));
+            for (const Person &person: m_people) {
+                const cv::Rect box(
+                        (int) person.position.x, (int) person.position.y, person.size.width, person.size.height);
+                cv::rectangle(*image, box, cv::Scalar(40, 60, 200), cv::FILLED);
+            }
+        }
+
+        void run(DetectionBatch *outDetections) {
+            outDetections->clear();
+            outDetections->reserve(m_people.size() + 2);
+            for (Person &person: m_people) {
+                person.position.x += person.velocity.x;
+                person.position.y += person.velocity.y;
+                if (person.position.x < 0 || person.position.x + (float) person.size.width > kFrameWidth)
+                    person.velocity.x = -person.velocity.x;
+                if (person.position.y < 0 || person.position.y + (float) person.size.height > kFrameHeight)
+                    person.velocity.y = -person.velocity.y;
+
+                const float outcome = m_unit(m_random);
+                if (outcome < 0.05f)
+                    continue; //< Missed.
+                const float confidence = outcome < 0.15f ? 0.2f + m_unit(m_random) * 0.3f : 0.6f + m_unit(m_random) * 0.35f;
+                outDetections->push_back(
+                        cv::Rect(
+                                (int) person.position.x + (int) m_jitter(m_random),
+                                (int) person.position.y + (int) m_jitter(m_random),
+                                person.size.width + (int) m_jitter(m_random),
+                                person.size.height + (int) m_jitter(m_random)),
+                        kPersonClassId,
+                        confidence);
+            }
+
+            // Not confident enough to start tracks.
+            for (int i = 0; i < 2; ++i) {
+                outDetections->push_back(
+                        cv::Rect(
+                                (int) (m_unit(m_random) * (kFrameWidth - 60)),
+                                (int) (m_unit(m_random) * (kFrameHeight - 150)),
+                                60,
+                                150),
+                        kPersonClassId,
+                        0.2f + m_unit(m_random) * 0.35f);
+            }
+        }
+
+    private:
+        std::mt19937 m_random{42};
+        std::uniform_real_distribution<float> m_unit{0, 1};
+        std::normal_distribution<float> m_jitter{0, 2};
+        std::vector<Person> m_people = std::vector<Person>(kPersonCount);
+    };
+
+    /** Stand-in for the classifier: the class of a region follows from its position. */
+    class SyntheticClassifier : public RegionClassifier {
+    public:
+        virtual std::pmr::vector<Classification> run(
+                const cv::Mat & /*frame*/,
+                const std::vector<cv::Rect> &regions,
+                std::pmr::memory_resource *memory) override {
+            std::pmr::vector<Classification> result(regions.size(), memory);
+            for (size_t i = 0; i < regions.size(); ++i)
+                result[i] = {regions[i].x < kFrameWidth / 2 ? 0 : 1, 0.9f};
+            return result;
+        }
+    };
+
+} // namespace
+
+int main() {
+    if (!kCountAllocations) {
+        std::printf("Allocations are not counted: build with -DcountAllocations=ON.\n");
+        return 0;
+    }
+
+    cv::Mat image(kFrameHeight, kFrameWidth, CV_8UC3);
+    SyntheticDetector detector;
+    SyntheticClassifier classifier;
+    TrackingStage trackingStage(&classifier, TrackerType::byteTrack);
+    trackingStage.setClassificationInterval(kClassificationIntervalUs);
+    trackingStage.setDetectionRate(kFrameRateHz);
+    SceneGate sceneGate;
+
+    // The same queues and ring of frame memories as DeviceAgent, passed through in turn.
+    PipelineChannel<QueuedFrame> frameQueue{4};
+    PipelineChannel<QueuedFrame> detectedFrameQueue{2};
+    std::array<FrameMemory, boundedQueueCapacity(2) + 2> frameMemory;
+    std::vector<TrackMotion> trackMotions;
+    std::vector<cv::Rect> trackedRegions;
+    AllocationMonitor monitor;
+
+    for (int frameIndex = 0; frameIndex < kFrameCount; ++frameIndex) {
+        if (frameIndex == kWarmUpFrameCount)
+            monitor.start();
+
+        detector.draw(&image);
+        const Frame frame(image, (int64_t) (frameIndex * 1'000'000 / kFrameRateHz), frameIndex);
+        QueuedFrame queuedFrame{frameIndex, &frameMemory[(size_t) frameIndex % frameMemory.size()]};
+        frameQueue.tryPush(queuedFrame);
+        {
+            const AllocationScope allocationScope(AllocationStage::detection);
+            frameQueue.pop(&queuedFrame);
+            sceneGate.check(frame.cvMat, frame.timestampUs, trackingStage.hasActiveTracks());
+            trackingStage.trackMotions(&trackMotions);
+            trackedRegions.clear();
+            for (const TrackMotion &trackMotion: trackMotions)
+                trackedRegions.push_back(trackMotion.predict(frame.timestampUs));
+            queuedFrame.memory->reset();
+            detector.run(&queuedFrame.memory->detections);
+            detectedFrameQueue.push(queuedFrame);
+        }
+
+        // TrackingStage counts its own stages.
+        detectedFrameQueue.pop(&queuedFrame);
+        trackingStage.run(frame, queuedFrame.memory); //< The packet is released as if the Server had handled it.
+        monitor.onFrame();
+    }
+    std::printf("%d people, %llu frames after %d warm-up frames\n",
+                kPersonCount, (unsigned long long) monitor.frames(), kWarmUpFrameCount);
+    std::printf("%-16s %12s %8s\n", "stage", "allocations", "budget");
+    for (size_t i = (size_t) AllocationStage::other + 1; i < kAllocationStageCount; ++i) {
+        const auto stage = (AllocationStage) i;
+        std::printf("%-16s %12.2f %8llu\n",
+                    allocationStageName(stage), monitor.allocationsPerFrame(stage), (unsigned long long) kBudget[i]);
+    }
+
+    if (!monitor.isWithin(kBudget)) {
+        std::printf("Over the allocation budget.\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+// Microbenchmark of the YOLO output decoding: the per-anchor scalar class loop the detector used
+// before YoloDecoder, against YoloDecoder scanning all classes and only the person class. All are
+// run on a synthetic 1x84x8400 output (the shape of yolo11n at 640x640) in which about 1% of the
+// anchors pass the confidence threshold.
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "simd.h"
+#include "yolo_decoder.h"
+
+using namespace nx_meta_plugin;
+
+namespace {
+
+    constexpr size_t kNumAnchors = 8400;
+    constexpr int kNumClasses = 80;
+    constexpr float kConfThreshold = 0.4f;
+    constexpr int kIterations = 2000;
+
+    std::vector<float> makeOutput() {
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> coordinate(0, 640);
+        std::exponential_distribution<float> lowScore(40);
+        std::uniform_real_distribution<float> highScore(kConfThreshold, 1);
+        std::uniform_int_distribution<int> anyClass(0, kNumClasses - 1);
+
+        std::vector<float> output((4 + kNumClasses) * kNumAnchors);
+        for (size_t a = 0; a < kNumAnchors; ++a) {
+            for (int row = 0; row < 4; ++row)
+                output[row * kNumAnchors + a] = coordinate(random);
+            for (int c = 0; c < kNumClasses; ++c)
+                output[(4 + c) * kNumAnchors + a] = std::min(lowScore(random), 0.3f);
+            if (a % 100 == 0)
+                output[(4 + anyClass(random)) * kNumAnchors + a] = highScore(random);
+        }
+        return output;
+    }
+
+    /** The decoding loop of YOLO11Detector::postprocess() before YoloDecoder. */
+    void findCandidatesScalar(const float *output, std::vector<YoloCandidate> *outCandidates) {
+        outCandidates->clear();
+        for (size_t d = 0; d < kNumAnchors; ++d) {
+            int classId = -1;
+            float maxScore = -FLT_MAX;
+            for (int c = 0; c < kNumClasses; ++c) {
+                const float score = output[d + (4 + c) * kNumAnchors];
+                if (score > maxScore) {
+                    maxScore = score;
+                    classId = c;
+                }
+            }
+            if (maxScore > kConfThreshold)
+                outCandidates->push_back({(int32_t) d, classId, maxScore});
+        }
+    }
+
+    template<typename Function>
+    double measureUs(Function function) {
+        function(); //< Warm up.
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kIterations; ++i)
+            function();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count()
+               / kIterations;
+    }
+
+}
+
+int main() {
+    const std::vector<float> output = makeOutput();
+
+    std::vector<YoloCandidate> scalarCandidates;
+    const double scalarUs = measureUs([&]() { findCandidatesScalar(output.data(), &scalarCandidates); });
+
+    YoloDecoder decoder;
+    const std::vector<YoloCandidate> *candidates = nullptr;
+    const double decoderUs = measureUs(
+            [&]() {
+                candidates = &decoder.findCandidates(
+                        output.data() + 4 * kNumAnchors, kNumAnchors, kNumClasses, kConfThreshold);
+            });
+
+    YoloDecoder personDecoder(ClassMask{0});
+    const double personDecoderUs = measureUs(
+            [&]() {
+                personDecoder.findCandidates(
+                        output.data() + 4 * kNumAnchors, kNumAnchors, kNumClasses, kConfThreshold);
+            });
+
+    bool identical = candidates->size() == scalarCandidates.size();
+    for (size_t i = 0; identical && i < scalarCandidates.size(); ++i) {
+        identical = (*candidates)[i].anchor == scalarCandidates[i].anchor
+                    && (*candidates)[i].classId == scalarCandidates[i].classId
+                    && (*candidates)[i].score == scalarCandidates[i].score;
+    }
+
+    std::printf("Decoding %zu anchors x %d classes, %zu candidates, %s kernels\n",
+                kNumAnchors, kNumClasses, scalarCandidates.size(), kSimdInstructionSet);
+    std::printf("  scalar per-anchor loop:   %8.1f us/frame\n", scalarUs);
+    std::printf("  YoloDecoder, all classes: %8.1f us/frame (%.1fx)\n", decoderUs, scalarUs / decoderUs);
+    std::printf("  YoloDecoder, person only: %8.1f us/frame (%.1fx)\n",
+                personDecoderUs, scalarUs / personDecoderUs);
+    std::printf("  results %s\n", identical ? "identical" : "DIFFER");
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+// Microbenchmark of NMS on a crowded frame: the greedy scalar NMS the detector used before
+// NmsEngine, against NmsEngine without limits and with its default topK and maxDetections. The
+// synthetic input has 200 people, each found by 10 overlapping anchors, in 640x640 model
+// coordinates.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "nms.h"
+#include "simd.h"
+
+using namespace nx_meta_plugin;
+
+namespace {
+
+    constexpr int kNumObjects = 200;
+    constexpr int kBoxesPerObject = 10;
+    constexpr float kIouThreshold = 0.45f;
+    constexpr int kIterations = 200;
+
+    NmsBoxes makeBoxes() {
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> position(0, 600);
+        std::uniform_real_distribution<float> size(20, 80);
+        std::normal_distribution<float> jitter(0, 3);
+        std::uniform_real_distribution<float> score(0.4f, 1);
+
+        NmsBoxes boxes;
+        for (int i = 0; i < kNumObjects; ++i) {
+            const float left = position(random);
+            const float top = position(random);
+            const float width = size(random);
+            const float height = 2 * width;
+            for (int j = 0; j < kBoxesPerObject; ++j) {
+                const float x = left + jitter(random);
+                const float y = top + jitter(random);
+                boxes.push_back(x, y, x + width + jitter(random), y + height + jitter(random), score(random), 0);
+            }
+        }
+        return boxes;
+    }
+
+    /** The greedy NMS of the former NMSBoxes(), on all boxes, with the same IoU arithmetic. */
+    void nmsScalar(const NmsBoxes &boxes, std::vector<int32_t> *outKept) {
+        outKept->clear();
+        std::vector<int32_t> order(boxes.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = (int32_t) i;
+        std::sort(order.begin(), order.end(),
+                  [&boxes](int32_t a, int32_t b) { return boxes.scores[(size_t) a] > boxes.scores[(size_t) b]; });
+
+        std::vector<bool> suppressed(boxes.size(), false);
+        for (size_t i = 0; i < order.size(); ++i) {
+            const size_t a = (size_t) order[i];
+            if (suppressed[a])
+                continue;
+            outKept->push_back((int32_t) a);
+
+            const float areaA = (boxes.x2[a] - boxes.x1[a]) * (boxes.y2[a] - boxes.y1[a]);
+            for (size_t j = i + 1; j < order.size(); ++j) {
+                const size_t b = (size_t) order[j];
+                const float width = std::max(0.0f,
+                        std::min(boxes.x2[a], boxes.x2[b]) - std::max(boxes.x1[a], boxes.x1[b]));
+                const float height = std::max(0.0f,
+                        std::min(boxes.y2[a], boxes.y2[b]) - std::max(boxes.y1[a], boxes.y1[b]));
+                const float intersection = width * height;
+                const float areaB = (boxes.x2[b] - boxes.x1[b]) * (boxes.y2[b] - boxes.y1[b]);
+                if (intersection > kIouThreshold * (areaA + areaB - intersection))
+                    suppressed[b] = true;
+            }
+        }
+    }
+
+    template<typename Function>
+    double measureUs(Function function) {
+        function(); //< Warm up.
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kIterations; ++i)
+            function();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count()
+               / kIterations;
+    }
+
+}
+
+int main() {
+    const NmsBoxes boxes = makeBoxes();
+
+    std::vector<int32_t> scalarKept;
+    const double scalarUs = measureUs([&]() { nmsScalar(boxes, &scalarKept); });
+
+    NmsEngine unlimitedEngine({/*topK*/ 0, /*maxDetections*/ 0});
+    const std::vector<int32_t> *kept = nullptr;
+    const double unlimitedUs = measureUs([&]() { kept = &unlimitedEngine.run(boxes, kIouThreshold); });
+
+    NmsEngine engine;
+    const std::vector<int32_t> *limitedKept = nullptr;
+    const double engineUs = measureUs([&]() { limitedKept = &engine.run(boxes, kIouThreshold); });
+
+    const bool identical = *kept == scalarKept;
+
+    std::printf("NMS of %zu boxes of one class, %zu kept, %s kernels\n",
+                boxes.size(), scalarKept.size(), kSimdInstructionSet);
+    std::printf("  scalar greedy NMS:           %8.1f us/frame\n", scalarUs);
+    std::printf("  NmsEngine, no limits:        %8.1f us/frame (%.1fx)\n", unlimitedUs, scalarUs / unlimitedUs);
+    std::printf("  NmsEngine, topK 300, max 100: %7.1f us/frame (%.1fx), %zu kept\n",
+                engineUs, scalarUs / engineUs, limitedKept->size());
+    std::printf("  results %s\n", identical ? "identical" : "DIFFER");
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+// Microbenchmark of the fast appearance descriptor and distance of the cv::tbm tracker: the
+// ResizedImageDescriptor and MatchTemplateDistance the tracker used before, against
+// SampledImageDescriptor and CrossCorrelationDistance. The synthetic input is a 1080p frame of
+// random blocks with 100 person-sized boxes, and the distances of all 100x100 box pairs, as the
+// tracker computes them between its tracks and the detections.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "simd.h"
+#include "tbm_descriptor.h"
+
+using namespace nx_meta_plugin;
+
+namespace {
+
+    constexpr int kNumBoxes = 100;
+    constexpr int kIterations = 100;
+
+    /** The former and the new distances may differ by float rounding only. */
+    constexpr float kMaxDistanceDifference = 1e-5f;
+
+    cv::Mat makeFrame() {
+        std::mt19937 random(42);
+        cv::Mat frame(1080, 1920, CV_8UC3);
+        for (int y = 0; y < frame.rows; y += 8) {
+            for (int x = 0; x < frame.cols; x += 8) {
+                const cv::Scalar color((double) (random() % 256), (double) (random() % 256), (double) (random() % 256));
+                cv::rectangle(frame, cv::Point(x, y), cv::Point(x + 7, y + 7), color, cv::FILLED);
+            }
+        }
+        return frame;
+    }
+
+    cv::tbm::TrackedObjects makeDetections() {
+        std::mt19937 random(7);
+        std::uniform_int_distribution<int> width(40, 200);
+        cv::tbm::TrackedObjects detections;
+        for (int i = 0; i < kNumBoxes; ++i) {
+            const int boxWidth = width(random);
+            const int boxHeight = 5 * boxWidth / 2;
+            const cv::Rect box(
+                    (int) (random() % (unsigned) (1920 - boxWidth)), (int) (random() % (unsigned) (1080 - boxHeight)),
+                    boxWidth, boxHeight);
+            detections.push_back(cv::tbm::TrackedObject(box, 0.9f, 0, -1));
+        }
+        return detections;
+    }
+
+    template<typename Function>
+    double measureUs(Function function) {
+        function(); //< Warm up.
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kIterations; ++i)
+            function();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count()
+               / kIterations;
+    }
+
+    void computeDistances(
+            cv::tbm::IDescriptorDistance *distance,
+            const std::vector<cv::Mat> &descriptors,
+            std::vector<float> *outDistances) {
+        outDistances->clear();
+        for (const cv::Mat &descriptor1: descriptors) {
+            for (const cv::Mat &descriptor2: descriptors)
+                outDistances->push_back(distance->compute(descriptor1, descriptor2));
+        }
+    }
+
+    float maxDifference(const std::vector<float> &a, const std::vector<float> &b) {
+        float result = 0;
+        for (size_t i = 0; i < a.size(); ++i)
+            result = std::max(result, std::abs(a[i] - b[i]));
+        return result;
+    }
+
+}
+
+int main() {
+    const cv::Mat frame = makeFrame();
+    const cv::tbm::TrackedObjects detections = makeDetections();
+
+    // The tracker computes the descriptors from copies of the crops either way.
+    std::vector<cv::Mat> crops;
+    for (const cv::tbm::TrackedObject &detection: detections)
+        crops.push_back(frame(detection.rect).clone());
+
+    cv::tbm::ResizedImageDescriptor resizedDescriptor(
+            cv::Size(SampledImageDescriptor::kWidth, SampledImageDescriptor::kHeight), cv::INTER_LINEAR);
+    std::vector<cv::Mat> resizedDescriptors;
+    const double resizedUs = measureUs([&]() { resizedDescriptor.compute(crops, resizedDescriptors); });
+
+    const cv::tbm::TrackerParams params;
+    SampledImageDescriptor sampledDescriptor;
+    std::vector<cv::Mat> sampledDescriptors;
+    cv::tbm::TrackedObjects moved = detections; //< Nothing is stationary.
+    int shift = 2;
+    const double sampledUs = measureUs([&]() {
+        for (cv::tbm::TrackedObject &detection: moved)
+            detection.rect.x += shift;
+        shift = -shift;
+        sampledDescriptor.prepare(frame, moved, params);
+        sampledDescriptor.compute(crops, sampledDescriptors);
+    });
+    const double reusedUs = measureUs([&]() {
+        sampledDescriptor.prepare(frame, detections, params);
+        sampledDescriptor.compute(crops, sampledDescriptors);
+    });
+
+    std::vector<float> templateDistances;
+    cv::tbm::MatchTemplateDistance templateDistance;
+    const double templateUs = measureUs(
+            [&]() { computeDistances(&templateDistance, resizedDescriptors, &templateDistances); });
+
+    std::vector<float> correlationDistances;
+    CrossCorrelationDistance correlationDistance;
+    const double correlationUs = measureUs(
+            [&]() { computeDistances(&correlationDistance, resizedDescriptors, &correlationDistances); });
+
+    std::vector<float> sampledDistances;
+    computeDistances(&correlationDistance, sampledDescriptors, &sampledDistances);
+
+    const float distanceDifference = maxDifference(templateDistances, correlationDistances);
+    const bool identical = distanceDifference <= kMaxDistanceDifference;
+
+    std::printf("Descriptors of %d boxes and their %d distances, %s kernels\n",
+                kNumBoxes, kNumBoxes * kNumBoxes, kSimdInstructionSet);
+    std::printf("  ResizedImageDescriptor:          %8.1f us/frame\n", resizedUs);
+    std::printf("  SampledImageDescriptor:          %8.1f us/frame (%.1fx)\n", sampledUs, resizedUs / sampledUs);
+    std::printf("  SampledImageDescriptor, reused:  %8.1f us/frame (%.1fx)\n", reusedUs, resizedUs / reusedUs);
+    std::printf("  MatchTemplateDistance:           %8.1f us/frame\n", templateUs);
+    std::printf("  CrossCorrelationDistance:        %8.1f us/frame (%.1fx)\n",
+                correlationUs, templateUs / correlationUs);
+    std::printf("  distances %s (max difference %g); with sampled descriptors max difference %g\n",
+                identical ? "identical" : "DIFFER", distanceDifference,
+                maxDifference(templateDistances, sampledDistances));
+    return identical ? 0 : 1;
+}
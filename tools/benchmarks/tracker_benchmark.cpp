@@ -0,0 +1,179 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+// Benchmark of the tracker backends on synthetic crowds: time per frame and identity switches of
+// the cv::tbm tracker against ByteTracker. People walk at constant speed across a 1080p frame and
+// bounce off its borders; each frame most of them are detected with some jitter, some only with a
+// low confidence (as when occluded), some are missed, and there are a few false positives. Every
+// person is drawn in a color of its own, so that the appearance descriptors of tbm are meaningful.
+//
+// After the crowd leaves, every tracker must forget all its tracks within the forget delay; the
+// benchmark exits with 1 if one does not.
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "tracker_backend.h"
+
+using namespace nx_meta_plugin;
+
+namespace {
+
+    constexpr int kFrameWidth = 1920;
+    constexpr int kFrameHeight = 1080;
+    constexpr int kFrameCount = 450;
+    constexpr double kFrameRateHz = 15;
+    constexpr size_t kForgetDelayFrames = 75;
+
+    struct Person {
+        cv::Point2f position;
+        cv::Point2f velocity; /**< Pixels per frame. */
+        cv::Size size;
+        cv::Scalar color;
+    };
+
+    struct SceneFrame {
+        cv::Mat image;
+        cv::tbm::TrackedObjects detections;
+        std::vector<int> personIndices; /**< Person of each detection, or -1 for false positives. */
+        int64_t timestampUs = 0;
+    };
+
+    std::vector<SceneFrame> makeScene(int personCount) {
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> unit(0, 1);
+        std::uniform_real_distribution<float> speed(-4, 4);
+        std::normal_distribution<float> jitter(0, 2);
+
+        std::vector<Person> people(personCount);
+        for (Person &person: people) {
+            const int width = 30 + (int) (unit(random) * 40);
+            person.size = cv::Size(width, 5 * width / 2);
+            person.position = cv::Point2f(
+                    unit(random) * (float) (kFrameWidth - person.size.width),
+                    unit(random) * (float) (kFrameHeight - person.size.height));
+            person.velocity = cv::Point2f(speed(random), speed(random) / 2);
+            person.color = cv::Scalar(unit(random) * 255, unit(random) * 255, unit(random) * 255);
+        }
+
+        std::vector<SceneFrame> frames(kFrameCount);
+        for (int frameIndex = 0; frameIndex < kFrameCount; ++frameIndex) {
+            SceneFrame &frame = frames[(size_t) frameIndex];
+            frame.timestampUs = (int64_t) (frameIndex * 1'000'000 / kFrameRateHz);
+            frame.image = cv::Mat(kFrameHeight, kFrameWidth, CV_8UC3, cv::Scalar(96, 96, 96));
+
+            for (int i = 0; i < personCount; ++i) {
+                Person &person = people[(size_t) i];
+                person.position.x += person.velocity.x;
+                person.position.y += person.velocity.y;
+                if (person.position.x < 0 || person.position.x + (float) person.size.width > kFrameWidth)
+                    person.velocity.x = -person.velocity.x;
+                if (person.position.y < 0 || person.position.y + (float) person.size.height > kFrameHeight)
+                    person.velocity.y = -person.velocity.y;
+
+                const cv::Rect box(
+                        (int) person.position.x, (int) person.position.y, person.size.width, person.size.height);
+                cv::rectangle(frame.image, box.tl(), box.br(), person.color, cv::FILLED);
+
+                const float outcome = unit(random);
+                if (outcome < 0.05f)
+                    continue; //< Missed.
+                const float confidence = outcome < 0.15f ? 0.2f + unit(random) * 0.3f : 0.5f + unit(random) * 0.45f;
+                const cv::Rect detectedBox(
+                        box.x + (int) jitter(random), box.y + (int) jitter(random),
+                        box.width + (int) jitter(random), box.height + (int) jitter(random));
+                frame.detections.push_back(cv::tbm::TrackedObject(detectedBox, confidence, frameIndex, -1));
+                frame.personIndices.push_back(i);
+            }
+
+            for (int i = 0; i < 2; ++i) {
+                const cv::Rect falsePositive(
+                        (int) (unit(random) * (kFrameWidth - 60)), (int) (unit(random) * (kFrameHeight - 150)), 60, 150);
+                frame.detections.push_back(
+                        cv::tbm::TrackedObject(falsePositive, 0.2f + unit(random) * 0.35f, frameIndex, -1));
+                frame.personIndices.push_back(-1);
+            }
+        }
+        return frames;
+    }
+
+    struct Result {
+        double msPerFrame = 0;
+        int idSwitches = 0;
+        size_t trackCount = 0;
+        bool forgetsTracks = false; /**< Whether no track is left once the crowd is gone. */
+    };
+
+    Result run(TrackerType type, const std::vector<SceneFrame> &frames) {
+        const std::unique_ptr<TrackerBackend> tracker = createTrackerBackend(type);
+        tracker->setForgetDelay(kForgetDelayFrames);
+
+        Result result;
+        std::map<int, int> personTracks; //< Last track of every person.
+        std::map<int, bool> tracks;
+        std::chrono::steady_clock::duration elapsed{0};
+        for (const SceneFrame &frame: frames) {
+            const auto start = std::chrono::steady_clock::now();
+            const cv::tbm::TrackedObjects tracked = tracker->process(frame.image, frame.detections, frame.timestampUs);
+            elapsed += std::chrono::steady_clock::now() - start;
+
+            for (const cv::tbm::TrackedObject &object: tracked) {
+                tracks[object.object_id] = true;
+
+                // The tracked objects keep the rects of the detections.
+                for (size_t i = 0; i < frame.detections.size(); ++i) {
+                    const int person = frame.personIndices[i];
+                    if (person < 0 || frame.detections[i].rect != object.rect)
+                        continue;
+                    const auto previous = personTracks.find(person);
+                    if (previous != personTracks.end() && previous->second != object.object_id)
+                        ++result.idSwitches;
+                    personTracks[person] = object.object_id;
+                    break;
+                }
+            }
+        }
+
+        result.msPerFrame = std::chrono::duration<double, std::milli>(elapsed).count() / (double) frames.size();
+        result.trackCount = tracks.size();
+
+        // The crowd leaves: after the forget delay, nothing may be tracked any more.
+        const SceneFrame &lastFrame = frames.back();
+        for (size_t i = 1; i <= kForgetDelayFrames + 1; ++i) {
+            tracker->process(lastFrame.image, cv::tbm::TrackedObjects(),
+                             lastFrame.timestampUs + (int64_t) (i * 1'000'000 / kFrameRateHz));
+        }
+        std::vector<TrackMotion> trackMotions;
+        tracker->trackMotions(&trackMotions);
+        result.forgetsTracks = !tracker->hasActiveTracks() && trackMotions.empty();
+        return result;
+    }
+
+}
+
+int main() {
+    int exitCode = 0;
+    for (const int personCount: {10, 40, 100}) {
+        const std::vector<SceneFrame> frames = makeScene(personCount);
+
+        std::printf("%d people, %d frames\n", personCount, kFrameCount);
+        for (const TrackerType type: {TrackerType::tbm, TrackerType::byteTrack}) {
+            const Result result = run(type, frames);
+            std::printf("  %-10s %8.3f ms/frame, %4d ID switches, %4zu tracks\n",
+                        type == TrackerType::tbm ? "tbm:" : "ByteTrack:",
+                        result.msPerFrame, result.idSwitches, result.trackCount);
+            if (!result.forgetsTracks) {
+                std::printf("  FAILED: tracks are left %zu frames after the last detection\n",
+                            kForgetDelayFrames + 1);
+                exitCode = 1;
+            }
+        }
+    }
+    return exitCode;
+}
@@ -0,0 +1,267 @@
+#!/usr/bin/env python3
+# Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+"""
+Statically quantizes the detector or the classifier of the plugin to INT8 and compares the result
+with the FP32 model.
+
+Calibration data is built from a local folder of frames (or of person crops, for the classifier),
+preprocessed exactly as the plugin does: letterboxed to the model input size with gray (114)
+padding, scaled to [0, 1] and laid out as CHW, in BGR order for the detector and RGB order for the
+classifier.
+
+The quantized model is written next to the FP32 one as `<name>.int8.onnx`, which is the name the
+plugin looks for when the "Prefer INT8 models" Engine setting is on.
+
+Example:
+    python3 quantize_int8.py --model yolov11n.onnx --frames ~/frames
+"""
+
+import argparse
+import os
+import sys
+import time
+
+import cv2
+import numpy as np
+import onnxruntime as ort
+from onnxruntime.quantization import (
+    CalibrationDataReader,
+    CalibrationMethod,
+    QuantFormat,
+    QuantType,
+    quantize_static,
+)
+
+IMAGE_EXTENSIONS = (".jpg", ".jpeg", ".png", ".bmp")
+
+# Same thresholds as YOLO11Detector::postprocess() and YOLO11Classifier::postprocess().
+DETECTOR_CONF_THRESHOLD = 0.4
+CLASSIFIER_CONF_THRESHOLD = 0.25
+NMS_IOU_THRESHOLD = 0.45
+
+# Detections of the two models are considered the same if they have the same class and overlap
+# at least this much.
+MATCH_IOU_THRESHOLD = 0.5
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--model", required=True, help="FP32 ONNX model to quantize.")
+    parser.add_argument("--frames", required=True, help="Folder with the calibration frames.")
+    parser.add_argument("--output", help="Quantized model path; defaults to <model>.int8.onnx.")
+    parser.add_argument("--kind", choices=["detector", "classifier"],
+                        help="Model kind; guessed from the model file name by default.")
+    parser.add_argument("--format", choices=["qdq", "qoperator"], default="qdq",
+                        help="QDQ keeps QuantizeLinear/DequantizeLinear pairs which ONNX Runtime fuses; "
+                             "QOperator uses quantized operators directly.")
+    parser.add_argument("--calibration-method", choices=["minmax", "entropy", "percentile"], default="minmax")
+    parser.add_argument("--per-channel", action="store_true", help="Quantize the weights per channel.")
+    parser.add_argument("--calibration-frames", type=int, default=200,
+                        help="Maximum number of frames used for calibration.")
+    parser.add_argument("--evaluation-frames", type=int, default=50,
+                        help="Maximum number of frames used to compare the models; taken from the frames not "
+                             "used for calibration when there are enough of them.")
+    parser.add_argument("--threads", type=int, default=min(6, os.cpu_count() or 1),
+                        help="Intra-op threads, the same default as the plugin.")
+    return parser.parse_args()
+
+
+def list_frames(folder):
+    paths = sorted(
+        os.path.join(folder, name) for name in os.listdir(folder)
+        if name.lower().endswith(IMAGE_EXTENSIONS))
+    if not paths:
+        sys.exit(f"No frames ({', '.join(IMAGE_EXTENSIONS)}) found in {folder}")
+    return paths
+
+
+def model_input(session):
+    """Returns the input name and the (height, width) of the model input, 640x640 if dynamic."""
+    model_input = session.get_inputs()[0]
+    height, width = model_input.shape[2], model_input.shape[3]
+    if not isinstance(height, int) or not isinstance(width, int):
+        height, width = 640, 640
+    return model_input.name, (height, width)
+
+
+def letterbox(image, size):
+    """Same geometry as letterBox() with auto_ == false in geometry.h."""
+    height, width = size
+    ratio = min(height / image.shape[0], width / image.shape[1])
+    resized_width = int(round(image.shape[1] * ratio))
+    resized_height = int(round(image.shape[0] * ratio))
+    if (resized_width, resized_height) != (image.shape[1], image.shape[0]):
+        image = cv2.resize(image, (resized_width, resized_height), interpolation=cv2.INTER_LINEAR)
+    pad_width = width - resized_width
+    pad_height = height - resized_height
+    return cv2.copyMakeBorder(
+        image, pad_height // 2, pad_height - pad_height // 2, pad_width // 2, pad_width - pad_width // 2,
+        cv2.BORDER_CONSTANT, value=(114, 114, 114))
+
+
+def preprocess(path, size, kind):
+    image = cv2.imread(path, cv2.IMREAD_COLOR)
+    if image is None:
+        return None
+    image = letterbox(image, size)
+    if kind == "classifier":
+        image = image[:, :, ::-1]
+    return np.ascontiguousarray(image.transpose(2, 0, 1)[np.newaxis], dtype=np.float32) / 255.0
+
+
+class FrameReader(CalibrationDataReader):
+    def __init__(self, paths, input_name, size, kind):
+        self._inputs = iter(
+            {input_name: tensor} for tensor in (preprocess(path, size, kind) for path in paths)
+            if tensor is not None)
+
+    def get_next(self):
+        return next(self._inputs, None)
+
+
+def iou(box, boxes):
+    """IoU of one (x1, y1, x2, y2) box with an array of boxes."""
+    x1 = np.maximum(box[0], boxes[:, 0])
+    y1 = np.maximum(box[1], boxes[:, 1])
+    x2 = np.minimum(box[2], boxes[:, 2])
+    y2 = np.minimum(box[3], boxes[:, 3])
+    intersection = np.clip(x2 - x1, 0, None) * np.clip(y2 - y1, 0, None)
+    area = (box[2] - box[0]) * (box[3] - box[1])
+    areas = (boxes[:, 2] - boxes[:, 0]) * (boxes[:, 3] - boxes[:, 1])
+    return intersection / np.maximum(area + areas - intersection, 1e-9)
+
+
+def decode(output, conf_threshold):
+    """Decodes a [1, 4 + classes, anchors] YOLO output into boxes, scores and class ids after NMS."""
+    predictions = output[0].T
+    scores = predictions[:, 4:].max(axis=1)
+    class_ids = predictions[:, 4:].argmax(axis=1)
+    keep = scores > conf_threshold
+    centers, sizes = predictions[keep, 0:2], predictions[keep, 2:4]
+    boxes = np.concatenate([centers - sizes / 2, centers + sizes / 2], axis=1)
+    scores, class_ids = scores[keep], class_ids[keep]
+
+    selected = []
+    for class_id in np.unique(class_ids):
+        indices = np.flatnonzero(class_ids == class_id)
+        indices = indices[np.argsort(-scores[indices])]
+        while indices.size:
+            selected.append(indices[0])
+            indices = indices[1:][iou(boxes[indices[0]], boxes[indices[1:]]) <= NMS_IOU_THRESHOLD]
+    selected = np.array(sorted(selected, key=lambda i: -scores[i]), dtype=np.int64)
+    return boxes[selected], scores[selected], class_ids[selected]
+
+
+def match(reference, candidate):
+    """Greedily matches the candidate detections to the reference ones; returns the matched IoUs."""
+    reference_boxes, _, reference_classes = reference
+    candidate_boxes, _, candidate_classes = candidate
+    used = np.zeros(len(candidate_boxes), dtype=bool)
+    ious = []
+    for box, class_id in zip(reference_boxes, reference_classes):
+        if not len(candidate_boxes):
+            break
+        overlaps = iou(box, candidate_boxes)
+        overlaps[used | (candidate_classes != class_id)] = 0
+        best = int(overlaps.argmax())
+        if overlaps[best] >= MATCH_IOU_THRESHOLD:
+            used[best] = True
+            ious.append(overlaps[best])
+    return ious
+
+
+def create_session(path, threads):
+    options = ort.SessionOptions()
+    options.intra_op_num_threads = threads
+    options.graph_optimization_level = ort.GraphOptimizationLevel.ORT_ENABLE_ALL
+    return ort.InferenceSession(path, options, providers=["CPUExecutionProvider"])
+
+
+def run_timed(session, input_name, tensors):
+    session.run(None, {input_name: tensors[0]})  # Warm up.
+    outputs = []
+    start = time.perf_counter()
+    for tensor in tensors:
+        outputs.append(session.run(None, {input_name: tensor})[0])
+    return outputs, (time.perf_counter() - start) * 1000 / len(tensors)
+
+
+def compare(fp32_path, int8_path, tensors, input_name, kind, threads):
+    fp32_outputs, fp32_ms = run_timed(create_session(fp32_path, threads), input_name, tensors)
+    int8_outputs, int8_ms = run_timed(create_session(int8_path, threads), input_name, tensors)
+
+    print(f"Frames compared:     {len(tensors)}")
+    print(f"FP32 inference:      {fp32_ms:.2f} ms/frame")
+    print(f"INT8 inference:      {int8_ms:.2f} ms/frame")
+    print(f"Speedup:             {fp32_ms / int8_ms:.2f}x")
+    print(f"Model size:          {os.path.getsize(fp32_path) / 2**20:.1f} MiB -> "
+          f"{os.path.getsize(int8_path) / 2**20:.1f} MiB")
+
+    if kind == "classifier":
+        # The plugin labels a crop with the class of its most confident box.
+        agreeing = 0
+        for fp32_output, int8_output in zip(fp32_outputs, int8_outputs):
+            fp32_classes = decode(fp32_output, CLASSIFIER_CONF_THRESHOLD)[2]
+            int8_classes = decode(int8_output, CLASSIFIER_CONF_THRESHOLD)[2]
+            fp32_label = fp32_classes[0] if len(fp32_classes) else -1
+            int8_label = int8_classes[0] if len(int8_classes) else -1
+            agreeing += int(fp32_label == int8_label)
+        print(f"Label agreement:     {100 * agreeing / len(tensors):.1f}%")
+        return
+
+    reference_count = candidate_count = 0
+    matched_ious = []
+    for fp32_output, int8_output in zip(fp32_outputs, int8_outputs):
+        reference = decode(fp32_output, DETECTOR_CONF_THRESHOLD)
+        candidate = decode(int8_output, DETECTOR_CONF_THRESHOLD)
+        reference_count += len(reference[0])
+        candidate_count += len(candidate[0])
+        matched_ious += match(reference, candidate)
+
+    # The FP32 detections are the reference: recall is the share of them the INT8 model finds too.
+    recall = len(matched_ious) / reference_count if reference_count else 1.0
+    precision = len(matched_ious) / candidate_count if candidate_count else 1.0
+    f1 = 2 * precision * recall / (precision + recall) if precision + recall else 0.0
+    print(f"Detections:          {reference_count} FP32, {candidate_count} INT8")
+    print(f"Agreement with FP32: recall {100 * recall:.1f}%, precision {100 * precision:.1f}%, F1 {100 * f1:.1f}%")
+    if matched_ious:
+        print(f"Mean IoU of matches: {np.mean(matched_ious):.3f}")
+
+
+def main():
+    args = parse_args()
+    kind = args.kind or ("classifier" if "classif" in os.path.basename(args.model) else "detector")
+    root, extension = os.path.splitext(args.model)
+    output = args.output or root + ".int8" + extension
+
+    paths = list_frames(args.frames)
+    calibration_paths = paths[:args.calibration_frames]
+    evaluation_paths = paths[len(calibration_paths):][:args.evaluation_frames]
+    if not evaluation_paths:
+        print("Not enough frames for a separate evaluation set, evaluating on the calibration frames.")
+        evaluation_paths = calibration_paths[:args.evaluation_frames]
+
+    input_name, size = model_input(create_session(args.model, args.threads))
+    print(f"Quantizing {args.model} ({kind}, input {size[1]}x{size[0]}) with {len(calibration_paths)} frames...")
+    quantize_static(
+        args.model,
+        output,
+        FrameReader(calibration_paths, input_name, size, kind),
+        quant_format=QuantFormat.QDQ if args.format == "qdq" else QuantFormat.QOperator,
+        per_channel=args.per_channel,
+        activation_type=QuantType.QUInt8,
+        weight_type=QuantType.QInt8,
+        calibrate_method={
+            "minmax": CalibrationMethod.MinMax,
+            "entropy": CalibrationMethod.Entropy,
+            "percentile": CalibrationMethod.Percentile,
+        }[args.calibration_method])
+    print(f"Wrote {output}")
+
+    tensors = [tensor for tensor in (preprocess(path, size, kind) for path in evaluation_paths) if tensor is not None]
+    compare(args.model, output, tensors, input_name, kind, args.threads)
+
+
+if __name__ == "__main__":
+    main()